@@ -0,0 +1,114 @@
+#include "../../lib/System/Sys.h"
+#include "../../lib/TextureManager/TM.h"
+#include "../../lib/GUI/gui.h"
+
+/** Rect Benchmark
+ *
+ * Draws a form like amount of rects every frame (filled, rounded,
+ * outlined, dashed and translucent dashed) plus some circles and rings,
+ * tessellated, from the ShapeAtlas and with damage tracking (the frames
+ * are all the same, so nothing should be redrawn), and reports how many
+ * textures were created per frame, how many draw calls the DrawList
+ * merged and how long a frame took.
+ *
+ * Runs on the offscreen video driver so it doesn't need a display.
+ */
+
+const int FRAMES = 300;
+
+void drawFrame(){
+    for(int i = 0; i < 200; i++){
+        SDL_Rect r = {10 + (i % 20) * 60, 10 + (i / 20) * 30, 50, 24};
+        GUI::Rect(r, THEME_COLOR_2);
+    }
+
+    for(int i = 0; i < 50; i++){
+        SDL_Rect r = {10 + (i % 10) * 120, 320 + (i / 10) * 40, 110, 32};
+        GUI::pushBorderRadius(8);
+        GUI::Rect(r, ACTIVE_COLOR_2);
+
+        GUI::pushBorderRadius(8);
+        GUI::Rect(r, SDL_COLOR_WHITE, 2);
+    }
+
+    for(int i = 0; i < 50; i++){
+        SDL_Rect r = {10 + (i % 10) * 120, 540 + (i / 10) * 40, 110, 32};
+        GUI::pushDashLineStyle(6, 4);
+        GUI::Rect(r, SDL_COLOR_RED, 2);
+
+        GUI::pushDashLineStyle(6, 4);
+        GUI::Rect(r, {255, 255, 255, 128}, 2);
+    }
+
+    for(int i = 0; i < 20; i++){
+        SDL_Point c = {30 + i * 60, 760};
+        GUI::Circle(c, 12, ACTIVE_COLOR_2);
+        GUI::Circle(c, 20, SDL_COLOR_WHITE, 2);
+    }
+}
+
+void runPass(const string& name){
+    Uint64 firstFrameTextures = 0;
+    Uint64 steadyTextures = 0;
+    Uint64 steadyTicks = 0;
+    Uint64 steadySubmitted = 0;
+    Uint64 steadyIssued = 0;
+    Uint64 steadyDamaged = 0;
+
+    for(int frame = 0; frame < FRAMES; frame++){
+        Sys::handleEvents();
+
+        Uint64 texturesBefore = TM::getCreatedTexturesCount();
+        Uint64 start = SDL_GetTicksNS();
+
+        drawFrame();
+
+        Uint64 duration = SDL_GetTicksNS() - start;
+        Uint64 created = TM::getCreatedTexturesCount() - texturesBefore;
+
+        if(frame == 0) firstFrameTextures = created;
+        else {
+            steadyTextures += created;
+            steadyTicks += duration;
+        }
+
+        DrawList::endFrame();
+        SDL_RenderPresent(Sys::renderer);
+
+        if(frame > 0){
+            DrawList::Stats stats = DrawList::getStats();
+            steadySubmitted += stats.submittedCalls;
+            steadyIssued += stats.issuedCalls;
+            steadyDamaged += stats.damagedArea;
+        }
+    }
+
+    cout << "-- " << name << endl;
+    cout << "Shapes per frame:              " << 200 + 50*2 + 50*2 + 40 << endl;
+    cout << "Textures created (1st frame):  " << firstFrameTextures << endl;
+    cout << "Textures created per frame:    " << (double)steadyTextures / (FRAMES - 1) << endl;
+    cout << "Draw calls submitted / frame:  " << (double)steadySubmitted / (FRAMES - 1) << endl;
+    cout << "Draw calls issued / frame:     " << (double)steadyIssued / (FRAMES - 1) << endl;
+    if(DrawList::isDamageTracking())
+        cout << "Damaged px per frame:          " << (double)steadyDamaged / (FRAMES - 1) << endl;
+    cout << "Draw time per frame (us):      " << (double)steadyTicks / (FRAMES - 1) / 1000.0 << endl;
+}
+
+int main(){
+    SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+
+    int err = Sys::initWindow("Rect Benchmark", false, 1280, 800);
+    CHECK_ERROR(err);
+    if(err != NO_ERROR) return 1;
+
+    runPass("Tessellated shapes");
+
+    ShapeAtlas::setEnabled(true);
+    runPass("ShapeAtlas shapes");
+
+    DrawList::setDamageTracking(true);
+    runPass("ShapeAtlas shapes, damage tracking");
+
+    Sys::cleanup();
+    return 0;
+}
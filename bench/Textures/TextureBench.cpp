@@ -0,0 +1,90 @@
+#include "../../lib/System/Sys.h"
+#include "../../lib/TextureManager/TM.h"
+#include "../../lib/GUI/gui.h"
+
+/** Texture Benchmark
+ *
+ * Stress test of the TextureData bookkeeping: creates and destroys
+ * COUNT TextureData objects in a few patterns and reports the time per
+ * object. The cost of one TextureData shouldn't depend on how many
+ * others are alive, so the numbers have to stay the same with a bigger
+ * COUNT (it was quadratic when the live textures were scanned).
+ *
+ * Runs on the offscreen video driver so it doesn't need a display.
+ */
+
+const int COUNT = 100000;
+
+static void report(const string& name, Uint64 ns){
+    cout << name << (double)ns / COUNT << " ns per TextureData" << endl;
+}
+
+// Empty handles, only created and destroyed
+void emptyHandles(){
+    Uint64 start = SDL_GetTicksNS();
+    for(int i = 0; i < COUNT; i++){
+        TextureData td;
+    }
+    report("Empty, create + destroy:       ", SDL_GetTicksNS() - start);
+}
+
+// All of them alive at once, every one with its own texture
+void liveHandles(){
+    vector<TextureData> live(COUNT);
+
+    Uint64 start = SDL_GetTicksNS();
+    for(TextureData& td : live){
+        td.setTexture(TM::createTexture(SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, 1, 1));
+    }
+    report("Live, setTexture:              ", SDL_GetTicksNS() - start);
+
+    // destroyTexture only queues them, they're freed right away insted of by presentFrame
+    start = SDL_GetTicksNS();
+    live.clear();
+    TM::flushDestroyedTextures();
+    report("Live, destroy (frees texture): ", SDL_GetTicksNS() - start);
+}
+
+// Like a text heavy screen: a window of live textures, the old ones get replaced
+void churn(){
+    const int WINDOW = 10000;
+    vector<TextureData> live(WINDOW);
+
+    Uint64 start = SDL_GetTicksNS();
+    for(int i = 0; i < COUNT; i++){
+        live[i % WINDOW].setTexture(TM::createTexture(SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, 1, 1));
+    }
+    TM::flushDestroyedTextures();
+    report("Churn, replace 10k window:     ", SDL_GetTicksNS() - start);
+}
+
+// Copies share the texture, it's freed once with the last of them
+void sharedHandles(){
+    TextureData owner;
+    owner.setTexture(TM::createTexture(SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, 1, 1));
+
+    vector<TextureData> handles(COUNT);
+
+    Uint64 start = SDL_GetTicksNS();
+    for(TextureData& td : handles) td.setTexture(owner.getTexture());
+    handles.clear();
+    report("Shared, set + destroy:         ", SDL_GetTicksNS() - start);
+}
+
+int main(){
+    SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+    SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+
+    int err = Sys::initWindow("Texture Benchmark", false, 1280, 800);
+    CHECK_ERROR(err);
+    if(err != NO_ERROR) return 1;
+
+    cout << "-- " << COUNT << " TextureData objects" << endl;
+    emptyHandles();
+    liveHandles();
+    churn();
+    sharedHandles();
+
+    Sys::cleanup();
+    return 0;
+}
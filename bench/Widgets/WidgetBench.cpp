@@ -0,0 +1,291 @@
+#include "../../lib/System/Sys.h"
+#include "../../lib/TextureManager/TM.h"
+#include "../../lib/GUI/gui.h"
+
+#include <fstream>
+#include <functional>
+
+/** Widget Benchmark
+ *
+ * Runs scripted widget scenarios headless (offscreen video driver,
+ * software renderer, bundled Lato font) and writes the results as JSON:
+ * ns per frame (mean, p50, p95), heap allocations per frame and the
+ * renderer counters from Sys::getFrameStats, so regressions show up
+ * as changed numbers.
+ *
+ *      make bench                              (from the repo root)
+ *      ./bench/Widgets/WidgetBench [frames] [out.json]
+ *
+ * Lumos logs to stdout, so the JSON goes into a file,
+ * WidgetBench.json by default.
+ */
+
+const int WARMUP_FRAMES = 5;
+int FRAMES = 60;
+
+
+
+// ALLOCATION COUNTING --------------------------------------------------------
+// Every operator new of the process goes trough here
+static std::atomic<Uint64> allocations{0};
+static std::atomic<Uint64> allocatedBytes{0};
+
+void* operator new(size_t size){
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+
+    void* p = std::malloc(size ? size : 1);
+    if(p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size){ return operator new(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+
+
+// SCENARIOS ------------------------------------------------------------------
+struct Scenario {
+    string name;
+    std::function<void(int frame)> draw;
+};
+
+static const char* LABELS[] = {
+    "Save", "Open", "Close", "Settings", "Profile", "Search", "Cancel", "Apply",
+    "Username", "Password", "Remember me", "Forgot password?", "Sign in", "Help",
+    "Dashboard", "Reports", "Messages", "Notifications", "Log out", "About"
+};
+static const int LABEL_COUNT = sizeof(LABELS) / sizeof(LABELS[0]);
+
+static void rects(int radius, bool dashed){
+    for(int i = 0; i < 10000; i++){
+        SDL_Rect r = {(i % 100) * 12, (i / 100) * 8, 40, 24};
+
+        if(radius > 0) GUI::pushBorderRadius(radius);
+        if(dashed){
+            GUI::pushDashLineStyle(6, 4);
+            GUI::Rect(r, ACTIVE_COLOR_2, 2);
+        } else {
+            GUI::Rect(r, THEME_COLOR_2);
+        }
+    }
+}
+
+static vector<Scenario> scenarios(){
+    return {
+        { "rect_plain_10k",   [](int){ rects(0, false); } },
+        { "rect_rounded_10k", [](int){ rects(8, false); } },
+        { "rect_dashed_10k",  [](int){ rects(0, true); } },
+
+        { "text_cached_5k", [](int){
+            for(int i = 0; i < 5000; i++){
+                SDL_Rect r = {(i % 50) * 25, (i / 50) * 8, -1, 16};
+                GUI::Text(LABELS[i % LABEL_COUNT], r, SDL_COLOR_WHITE);
+            }
+        }},
+
+        { "button_1k", [](int){
+            for(int i = 0; i < 1000; i++){
+                SDL_Rect r = {(i % 25) * 50, (i / 25) * 20, 48, 18};
+                GUI::Button(LABELS[i % LABEL_COUNT], r);
+            }
+        }},
+
+        { "input_200", [](int){
+            for(int i = 0; i < 200; i++){
+                SDL_Rect r = {(i % 10) * 125, (i / 10) * 38, 120, 32};
+                GUI::Input("bench-input-" + to_string(i), r, LABELS[i % LABEL_COUNT]);
+            }
+        }},
+
+        // Scrolls a bit further every frame, like a user flicking trough a list
+        { "container_scroll_2k", [](int frame){
+            const SDL_Rect view = {100, 50, 600, 700};
+            auto* state = GUI::getContainerState("bench-list");
+            int maxScroll = std::max(1, state->contentHeight - view.h);
+            state->scrollOffset = (frame * 40) % maxScroll;
+
+            GUI::beginContainer("bench-list", view);
+            for(int i = 0; i < 2000; i++){
+                SDL_Rect row = {0, i * 32, 580, 30};
+                GUI::Rect(row, (i % 2) ? THEME_COLOR_2 : THEME_COLOR_3);
+
+                SDL_Rect text = {10, i * 32 + 7, -1, 16};
+                GUI::Text(LABELS[i % LABEL_COUNT], text, SDL_COLOR_WHITE);
+            }
+            GUI::endContainer();
+        }},
+
+        // A 100k line document, only the lines in the view should cost anything
+        { "textarea_100k_lines", [](int frame){
+            if(GUI::getTextAreaValue("bench-area") == nullptr){
+                string doc;
+                for(int i = 0; i < 100000; i++) doc += "line " + to_string(i) + ": " + LABELS[i % LABEL_COUNT] + "\n";
+                GUI::setTextAreaValue("bench-area", doc);
+            }
+
+            auto* state = GUI::getContainerState("TextArea-bench-area");
+            state->scrollOffset = (frame * 160) % (100000 * 16);
+
+            GUI::TextArea("bench-area", {50, 50, 800, 700});
+        }},
+    };
+}
+
+
+
+// RUNNER ---------------------------------------------------------------------
+struct Result {
+    string name;
+    double nsMean;
+    double nsP50;
+    double nsP95;
+    double allocations;
+    double allocatedBytes;
+    Sys::FrameCounters counters;    // Sum over the measured frames
+};
+
+static Result run(const Scenario& scenario){
+    for(int frame = 0; frame < WARMUP_FRAMES; frame++){
+        Sys::handleEvents();
+        scenario.draw(frame);
+        Sys::presentFrame();
+    }
+
+    vector<Uint64> times;
+    times.reserve(FRAMES);
+
+    Sys::FrameCounters before = Sys::getFrameStats().total;
+    Uint64 allocsBefore = allocations.load();
+    Uint64 bytesBefore = allocatedBytes.load();
+
+    for(int frame = 0; frame < FRAMES; frame++){
+        Uint64 start = SDL_GetTicksNS();
+
+        Sys::handleEvents();
+        scenario.draw(WARMUP_FRAMES + frame);
+        Sys::presentFrame();
+
+        times.push_back(SDL_GetTicksNS() - start);
+    }
+
+    Result res = {};
+    res.name = scenario.name;
+    res.allocations = double(allocations.load() - allocsBefore) / FRAMES;
+    res.allocatedBytes = double(allocatedBytes.load() - bytesBefore) / FRAMES;
+
+    Sys::FrameCounters after = Sys::getFrameStats().total;
+    res.counters = {
+        after.geometryCalls     - before.geometryCalls,
+        after.lineCalls         - before.lineCalls,
+        after.fillRectCalls     - before.fillRectCalls,
+        after.textureCalls      - before.textureCalls,
+        after.clearCalls        - before.clearCalls,
+        after.readPixelsCalls   - before.readPixelsCalls,
+        after.vertices          - before.vertices,
+        after.indices           - before.indices,
+        after.targetSwitches    - before.targetSwitches,
+        after.texturesCreated   - before.texturesCreated,
+        after.texturesDestroyed - before.texturesDestroyed,
+        after.bytesUploaded     - before.bytesUploaded,
+        after.textCacheHits     - before.textCacheHits,
+        after.textCacheMisses   - before.textCacheMisses
+    };
+
+    Uint64 sum = 0;
+    for(Uint64 t : times) sum += t;
+    res.nsMean = double(sum) / FRAMES;
+
+    std::sort(times.begin(), times.end());
+    res.nsP50 = double(times[(FRAMES - 1) * 50 / 100]);
+    res.nsP95 = double(times[(FRAMES - 1) * 95 / 100]);
+
+    return res;
+}
+
+static void writeJson(std::ostream& out, const vector<Result>& results){
+    auto perFrame = [](Uint64 v){ return double(v) / FRAMES; };
+
+    out << "{\n";
+    out << "  \"video_driver\": \"" << SDL_GetCurrentVideoDriver() << "\",\n";
+    out << "  \"renderer\": \"" << SDL_GetRendererName(Sys::renderer) << "\",\n";
+    out << "  \"frames\": " << FRAMES << ",\n";
+    out << "  \"scenarios\": [\n";
+
+    for(size_t i = 0; i < results.size(); i++){
+        const Result& r = results[i];
+        const Sys::FrameCounters& c = r.counters;
+
+        out << "    {\n";
+        out << "      \"name\": \"" << r.name << "\",\n";
+        out << "      \"ns_per_frame\": " << r.nsMean << ",\n";
+        out << "      \"ns_per_frame_p50\": " << r.nsP50 << ",\n";
+        out << "      \"ns_per_frame_p95\": " << r.nsP95 << ",\n";
+        out << "      \"allocations_per_frame\": " << r.allocations << ",\n";
+        out << "      \"allocated_bytes_per_frame\": " << r.allocatedBytes << ",\n";
+        out << "      \"per_frame\": {\n";
+        out << "        \"render_calls\": "       << perFrame(c.renderCalls())     << ",\n";
+        out << "        \"geometry_calls\": "     << perFrame(c.geometryCalls)     << ",\n";
+        out << "        \"line_calls\": "         << perFrame(c.lineCalls)         << ",\n";
+        out << "        \"fill_rect_calls\": "    << perFrame(c.fillRectCalls)     << ",\n";
+        out << "        \"texture_calls\": "      << perFrame(c.textureCalls)      << ",\n";
+        out << "        \"clear_calls\": "        << perFrame(c.clearCalls)        << ",\n";
+        out << "        \"read_pixels_calls\": "  << perFrame(c.readPixelsCalls)   << ",\n";
+        out << "        \"vertices\": "           << perFrame(c.vertices)          << ",\n";
+        out << "        \"indices\": "            << perFrame(c.indices)           << ",\n";
+        out << "        \"target_switches\": "    << perFrame(c.targetSwitches)    << ",\n";
+        out << "        \"textures_created\": "   << perFrame(c.texturesCreated)   << ",\n";
+        out << "        \"textures_destroyed\": " << perFrame(c.texturesDestroyed) << ",\n";
+        out << "        \"bytes_uploaded\": "     << perFrame(c.bytesUploaded)     << ",\n";
+        out << "        \"text_cache_hits\": "    << perFrame(c.textCacheHits)     << ",\n";
+        out << "        \"text_cache_misses\": "  << perFrame(c.textCacheMisses)   << "\n";
+        out << "      }\n";
+        out << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+
+    out << "  ]\n}\n";
+}
+
+
+
+int main(int argc, char** argv){
+    if(argc > 1) FRAMES = std::max(1, atoi(argv[1]));
+    string outPath = (argc > 2) ? argv[2] : "WidgetBench.json";
+
+    // Headless and deterministic: no display, no GPU
+    SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen,dummy");
+    SDL_SetHint(SDL_HINT_RENDER_DRIVER, "software");
+
+    int err = Sys::initWindow("Widget Benchmark", false, 1280, 800);
+    CHECK_ERROR(err);
+    if(err != NO_ERROR) return 1;
+
+    // The font sits in bench/fonts, next to the directory of the binary
+    const char* base = SDL_GetBasePath();
+    err = Sys::initFont(string(base ? base : "./") + "../fonts/Lato-Regular.ttf");
+    CHECK_ERROR(err);
+    if(err != NO_ERROR) return 1;
+
+    // Measure the work, not the frame limiter
+    Sys::setFPS(0);
+
+    vector<Result> results;
+    for(const Scenario& s : scenarios()){
+        std::cerr << "[BENCH] " << s.name << "..." << std::endl;
+        results.push_back(run(s));
+    }
+
+    std::ofstream out(outPath);
+    if(!out.is_open()){
+        std::cerr << "[BENCH] Can't write " << outPath << std::endl;
+        return 1;
+    }
+    writeJson(out, results);
+    std::cerr << "[BENCH] Results written to " << outPath << std::endl;
+
+    Sys::cleanup();
+    return 0;
+}
@@ -0,0 +1,149 @@
+#include "gui.h"
+#include "../System/Sys.h"
+
+
+
+void GUI::queueText(LoadedText* text){
+    std::lock_guard<std::mutex> lock(textJobsMutex);
+
+    // Started with the first job, so apps that don't use text don't get threads
+    if(textWorkers.empty()){
+        stopTextWorkers = false;
+        for(int i = 0; i < asyncTextWorkers; i++) textWorkers.emplace_back(textWorker);
+    }
+
+    textJobs.push_back({text->title, text->fontSize, nullptr});
+    textJobsCV.notify_one();
+}
+
+
+
+void GUI::textWorker(){
+    PROFILE_THREAD("Text worker");
+
+    // TTF_Font can't be shared between threads, every worker opens its own
+    unordered_map<int, TTF_Font*> fonts;
+
+    while(true){
+        TextJob job;
+        {
+            std::unique_lock<std::mutex> lock(textJobsMutex);
+            textJobsCV.wait(lock, []{ return stopTextWorkers || !textJobs.empty(); });
+            if(stopTextWorkers) break;
+
+            job = std::move(textJobs.front());
+            textJobs.pop_front();
+        }
+
+        PROFILE_ZONE("GUI::textWorker");
+
+        auto it = fonts.find(job.fontSize);
+        TTF_Font* font = (it != fonts.end()) ? it->second : Sys::openFont(job.fontSize);
+        if(it == fonts.end() && font != nullptr) fonts.insert({job.fontSize, font});
+
+        // Same as TM::createTextTexture, up to the texture
+        if(font != nullptr){
+            SDL_Surface* surface = TTF_RenderText_Blended(font, job.title.c_str(), job.title.size(), SDL_COLOR_WHITE);
+            if(surface != nullptr && surface->format != SDL_PIXELFORMAT_RGBA32){
+                SDL_Surface* converted = SDL_ConvertSurface(surface, SDL_PIXELFORMAT_RGBA32);
+                SDL_DestroySurface(surface);
+                surface = converted;
+            }
+            job.surface = surface;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(textJobsMutex);
+            textResults.push_back(std::move(job));
+        }
+
+        // In idle mode the main thread might be waiting for events
+        Sys::requestWakeUp(0);
+    }
+
+    for(auto& [size, font] : fonts) Sys::closeFont(font);
+}
+
+
+
+void GUI::uploadTexts(){
+    PROFILE_ZONE("GUI::uploadTexts");
+
+    // Take the results out, the workers keep on adding while uploading
+    static vector<TextJob> done;
+    {
+        std::lock_guard<std::mutex> lock(textJobsMutex);
+        if(textResults.empty()) return;
+        done.swap(textResults);
+    }
+
+    Uint64 start = SDL_GetTicksNS();
+    size_t i = 0;
+
+    for(; i < done.size(); i++){
+        // Out of time, the rest waits for the next frame
+        if(i > 0 && SDL_GetTicksNS() - start > textUploadBudgetNS) break;
+
+        TextJob& job = done[i];
+        LoadedText* text = findText(hashText(job.title, job.fontSize), job.title, job.fontSize);
+
+        // Removed from the cache meanwhile, or it failed
+        if(text == nullptr || !text->pending || job.surface == nullptr){
+            if(job.surface) SDL_DestroySurface(job.surface);
+            if(text && text->pending && job.surface == nullptr){
+                CHECK_ERROR(TM_SURFACE_CREATE_ERROR);
+                removeText(text);
+            }
+            continue;
+        }
+
+        int err = TM::convert_toTexture(job.surface, text->td);
+        CHECK_ERROR(err);
+        SDL_DestroySurface(job.surface);
+        TM::setTextureCategory(text->td.getTexture(), TextureCategory::TEXT);
+
+        text->pending = false;
+        text->td.path = "TEXT";
+        text->td.id = "TEXT-" + text->title;
+        text->td.orgWidth = text->td.getWidth();
+        text->td.orgHeight = text->td.getHeight();
+
+        text->bytes = size_t(text->td.getWidth()) * text->td.getHeight() * SDL_BYTESPERPIXEL(text->td.getFormat());
+        textCacheBytes += text->bytes;
+    }
+
+    // Whatever didn't fit goes back in front of the newer results
+    if(i < done.size()){
+        std::lock_guard<std::mutex> lock(textJobsMutex);
+        textResults.insert(textResults.begin(), std::make_move_iterator(done.begin() + i), std::make_move_iterator(done.end()));
+        Sys::requestWakeUp(0);
+    }
+    done.clear();
+
+    // Uploads can push the cache over the budget, recently used texts stay
+    while(textCacheBudget > 0 && textCacheBytes > textCacheBudget && lruBack != lruFront){
+        removeOldestText();
+    }
+}
+
+
+
+void GUI::stopAsyncText(){
+    {
+        std::lock_guard<std::mutex> lock(textJobsMutex);
+        stopTextWorkers = true;
+        textJobs.clear();
+    }
+    textJobsCV.notify_all();
+
+    for(std::thread& t : textWorkers) t.join();
+    textWorkers.clear();
+
+    // Texts waiting for them would stay pending forever, drop them
+    for(TextJob& job : textResults) if(job.surface) SDL_DestroySurface(job.surface);
+    textResults.clear();
+
+    vector<LoadedText*> pending;
+    for(auto& [hash, text] : loadedTexts) if(text->pending) pending.push_back(text.get());
+    for(LoadedText* text : pending) removeText(text);
+}
@@ -8,6 +8,8 @@ CursorState GUI::Button(
     const SDL_Color& buttonColor,
     const SDL_Color& textColor
 ){
+    PROFILE_ZONE("GUI::Button");
+
     // COPY STYLES -------------------------------------------------------
     // First we copy the pushed styles
     int fontSize = GUI::pFontSize;
@@ -60,18 +62,21 @@ CursorState GUI::Button(
 
 
     // FIND BUTTON TEXTURE
+    // With the GlyphAtlas there is no texture, only the size of the text is needed
     LoadedText* textPointer = nullptr;
-
-    auto it = loadedTexts.find(getTextId(title, fontSize, textColor));
-    if (it != loadedTexts.end()) {
-        // Save the pointer to that LoadedText item
-        textPointer = &it->second;
-        
-        // Update with the current frame
-        textPointer->lastUsedFrame = Sys::getCurrentFrame();
-    } else {
-        // Create new Text Texture
-        textPointer = loadNewText(title, fontSize, textColor);
+    int textWidth = 0, textHeight = 0;
+    bool glyphText = GlyphAtlas::isEnabled() && GlyphAtlas::measure(title, fontSize, textWidth, textHeight);
+
+    if(!glyphText) textPointer = getText(title, fontSize);
+
+    if(textPointer != nullptr && !textPointer->pending){
+        textWidth = textPointer->td.getWidth();
+        textHeight = textPointer->td.getHeight();
+    } else if(textPointer != nullptr){
+        // Async text still rendering, the size is known anyway
+        TextMetrics m = measureText(title, fontSize);
+        textWidth = m.width;
+        textHeight = std::max(m.height, m.lineHeight);
     }
 
 
@@ -93,7 +98,7 @@ CursorState GUI::Button(
     text_dRect.h = fontSize;
 
     // DRECT WIDTH -----------------------------------------------------------------
-    text_dRect.w = text_dRect.h * (float)textPointer->td.getWidth() / textPointer->td.getHeight();
+    text_dRect.w = text_dRect.h * (float)textWidth / std::max(1, textHeight);
 
     // DRECT X POS
     if(textAlignX == Align::LEFT){
@@ -115,7 +120,10 @@ CursorState GUI::Button(
 
 
     // Now render the text
-    GUI::Image(textPointer->td, text_dRect);
+    if(!glyphText || !drawGlyphText(title, fontSize, text_dRect, textColor)){
+        if(textPointer == nullptr) textPointer = getText(title, fontSize);
+        if(!textPointer->pending) GUI::Image(textPointer->td.getTexture(), nullptr, text_dRect, textColor);
+    }
 
     if(Mouse::isHovering(dRect)){
         Mouse::setCursor(CursorType::POINTER);
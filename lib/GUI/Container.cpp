@@ -113,12 +113,10 @@ void GUI::renderVerticalScrollbar(
     }
 
     // 4) Draw track (dark gray, semi‐opaque)
-    SDL_SetRenderDrawColor(Sys::renderer, 45, 45, 45, 128);
-    SDL_RenderFillRect(Sys::renderer, &track);
+    DrawList::fillRect(track, {45, 45, 45, 128});
 
     // 5) Draw thumb (light gray)
-    SDL_SetRenderDrawColor(Sys::renderer, 180, 180, 180, 200);
-    SDL_RenderFillRect(Sys::renderer, &thumb);
+    DrawList::fillRect(thumb, {180, 180, 180, 200});
 }
 
 
@@ -0,0 +1,601 @@
+#include "gui.h"
+#include "../System/Sys.h"
+
+
+
+static bool sameRect(const SDL_Rect& a, const SDL_Rect& b){
+    return a.x == b.x && a.y == b.y && a.w == b.w && a.h == b.h;
+}
+
+// Damage tracking record hashes, hashBytes is in lib.h
+static uint64_t hashRect(uint64_t h, const SDL_Rect& r){
+    return hashBytes(&r, sizeof(r), h);
+}
+
+// Adds the rect to the list of damaged regions, merging it with
+// the ones it overlaps so the same pixels aren't redrawn twice
+static void addDamage(vector<SDL_Rect>& damage, SDL_Rect rect, const SDL_Rect& screen){
+    if(!SDL_GetRectIntersection(&rect, &screen, &rect)) return;
+
+    for(size_t i = 0; i < damage.size(); ){
+        if(SDL_HasRectIntersection(&damage[i], &rect)){
+            SDL_GetRectUnion(&damage[i], &rect, &rect);
+            damage.erase(damage.begin() + i);
+            i = 0;  // The bigger rect might overlap the ones before
+        } else {
+            i++;
+        }
+    }
+
+    damage.push_back(rect);
+}
+
+
+
+void DrawList::geometry(
+    SDL_Texture*        texture,
+    const SDL_Vertex*   verts,
+    int                 numVertices,
+    const int*          idx,
+    int                 numIndices
+) {
+    if(numVertices <= 0) return;
+    if(idx == nullptr) numIndices = numVertices;
+
+    current.submittedCalls++;
+    current.vertices += numVertices;
+    current.indices += numIndices;
+
+    // IMMEDIATE MODE ------------------------------------------------------
+    if(immediate){
+        SDL_RenderGeometry(Sys::renderer, texture, verts, numVertices, idx, idx ? numIndices : 0);
+        current.issuedCalls++;
+        Sys::counters.geometryCalls++;
+        Sys::counters.vertices += numVertices;
+        Sys::counters.indices += idx ? numIndices : 0;
+        return;
+    }
+
+    // FIND THE COMMAND TO APPEND TO ---------------------------------------
+    // Only the last command can be extended, so the paint order is kept
+    SDL_Texture* target = SDL_GetRenderTarget(Sys::renderer);
+
+    // Drawing into a texture changes its contents
+    if(target != nullptr) invalidateTexture(target);
+
+    Command* cmd = nullptr;
+    if(!commands.empty()){
+        Command& back = commands.back();
+        if(
+            back.kind == Kind::GEOMETRY &&
+            back.texture == texture &&
+            back.target == target &&
+            back.clipEnabled == clipEnabled &&
+            (!clipEnabled || sameRect(back.clip, clip)) &&
+            // Its data has to be at the end of the arrays, which
+            // isn't the case if something after it was already flushed
+            back.firstVertex + back.numVertices == static_cast<int>(vertices.size()) &&
+            back.firstIndex + back.numIndices == static_cast<int>(indices.size())
+        ) {
+            cmd = &back;
+        }
+    }
+
+    if(cmd == nullptr){
+        Command newCmd = {};
+        newCmd.kind = Kind::GEOMETRY;
+        newCmd.texture = texture;
+        newCmd.target = target;
+        newCmd.clipEnabled = clipEnabled;
+        newCmd.clip = clip;
+        newCmd.firstVertex = static_cast<int>(vertices.size());
+        newCmd.firstIndex = static_cast<int>(indices.size());
+
+        commands.push_back(newCmd);
+        cmd = &commands.back();
+    }
+
+    // APPEND THE DATA -----------------------------------------------------
+    // Indices are relative to the first vertex of the command
+    int base = cmd->numVertices;
+
+    vertices.insert(vertices.end(), verts, verts + numVertices);
+
+    if(idx != nullptr){
+        for(int i = 0; i < numIndices; i++) indices.push_back(base + idx[i]);
+    } else {
+        for(int i = 0; i < numVertices; i++) indices.push_back(base + i);
+    }
+
+    cmd->numVertices += numVertices;
+    cmd->numIndices += numIndices;
+
+    // DAMAGE TRACKING -----------------------------------------------------
+    if(target == nullptr && tracking()){
+        float minX = verts[0].position.x, maxX = minX;
+        float minY = verts[0].position.y, maxY = minY;
+        for(int i = 1; i < numVertices; i++){
+            minX = std::min(minX, verts[i].position.x);
+            maxX = std::max(maxX, verts[i].position.x);
+            minY = std::min(minY, verts[i].position.y);
+            maxY = std::max(maxY, verts[i].position.y);
+        }
+
+        // 1px margin, for the pixels the edges touch
+        SDL_Rect bounds = {
+            static_cast<int>(std::floor(minX)) - 1,
+            static_cast<int>(std::floor(minY)) - 1,
+            static_cast<int>(std::ceil(maxX) - std::floor(minX)) + 2,
+            static_cast<int>(std::ceil(maxY) - std::floor(minY)) + 2
+        };
+
+        uint64_t h = hashBytes(verts, sizeof(SDL_Vertex) * numVertices);
+        if(idx != nullptr) h = hashBytes(idx, sizeof(int) * numIndices, h);
+        if(texture != nullptr){
+            h = hashMix(h, reinterpret_cast<uintptr_t>(texture));
+            auto gen = textureGenerations.find(texture);
+            h = hashMix(h, gen != textureGenerations.end() ? gen->second : 0);
+        }
+
+        record(bounds, h, *cmd);
+    }
+}
+
+
+
+void DrawList::fillRect(
+    const SDL_FRect&    rect,
+    const SDL_Color&    color
+) {
+    if(immediate){
+        current.submittedCalls++;
+        current.issuedCalls++;
+        SDL_SetRenderDrawColor(Sys::renderer, color);
+        SDL_RenderFillRect(Sys::renderer, &rect);
+        Sys::counters.fillRectCalls++;
+        return;
+    }
+
+    SDL_FColor fcol = TO_FCOLOR(color);
+
+    SDL_Vertex quad[4] = {
+        { {rect.x,          rect.y},          fcol, {0, 0} },
+        { {rect.x + rect.w, rect.y},          fcol, {0, 0} },
+        { {rect.x + rect.w, rect.y + rect.h}, fcol, {0, 0} },
+        { {rect.x,          rect.y + rect.h}, fcol, {0, 0} }
+    };
+    const int quadIndices[6] = { 0, 1, 2, 0, 2, 3 };
+
+    geometry(nullptr, quad, 4, quadIndices, 6);
+}
+
+
+
+void DrawList::texture(
+    SDL_Texture*        texture,
+    const SDL_FRect*    srcRect,
+    const SDL_FRect&    dstRect,
+    const SDL_Color&    tint
+) {
+    if(texture == nullptr) return;
+
+    if(immediate){
+        current.submittedCalls++;
+        current.issuedCalls++;
+
+        SDL_SetTextureColorMod(texture, tint.r, tint.g, tint.b);
+        SDL_SetTextureAlphaMod(texture, tint.a);
+        SDL_RenderTexture(Sys::renderer, texture, srcRect, &dstRect);
+        SDL_SetTextureColorMod(texture, 255, 255, 255);
+        SDL_SetTextureAlphaMod(texture, 255);
+
+        Sys::counters.textureCalls++;
+        return;
+    }
+
+    // Convert the source rect (in pixels) into texture coordinates
+    float u0 = 0.f, v0 = 0.f, u1 = 1.f, v1 = 1.f;
+    if(srcRect != nullptr){
+        float texW = 0, texH = 0;
+        SDL_GetTextureSize(texture, &texW, &texH);
+        if(texW <= 0 || texH <= 0) return;
+
+        u0 = srcRect->x / texW;
+        v0 = srcRect->y / texH;
+        u1 = (srcRect->x + srcRect->w) / texW;
+        v1 = (srcRect->y + srcRect->h) / texH;
+    }
+
+    const SDL_FColor col = TO_FCOLOR(tint);
+    const SDL_FRect& d = dstRect;
+
+    SDL_Vertex quad[4] = {
+        { {d.x,       d.y},       col, {u0, v0} },
+        { {d.x + d.w, d.y},       col, {u1, v0} },
+        { {d.x + d.w, d.y + d.h}, col, {u1, v1} },
+        { {d.x,       d.y + d.h}, col, {u0, v1} }
+    };
+    const int quadIndices[6] = { 0, 1, 2, 0, 2, 3 };
+
+    geometry(texture, quad, 4, quadIndices, 6);
+}
+
+
+
+void DrawList::line(
+    float x1, float y1,
+    float x2, float y2,
+    const SDL_Color& color
+) {
+    current.submittedCalls++;
+
+    if(immediate){
+        current.issuedCalls++;
+        SDL_SetRenderDrawColor(Sys::renderer, color);
+        SDL_RenderLine(Sys::renderer, x1, y1, x2, y2);
+        Sys::counters.lineCalls++;
+        return;
+    }
+
+    Command cmd = {};
+    cmd.kind = Kind::LINE;
+    cmd.target = SDL_GetRenderTarget(Sys::renderer);
+    cmd.clipEnabled = clipEnabled;
+    cmd.clip = clip;
+    cmd.p1 = {x1, y1};
+    cmd.p2 = {x2, y2};
+    cmd.color = color;
+
+    if(cmd.target != nullptr) invalidateTexture(cmd.target);
+
+    commands.push_back(cmd);
+
+    if(cmd.target == nullptr && tracking()){
+        SDL_Rect bounds = {
+            static_cast<int>(std::floor(std::min(x1, x2))) - 1,
+            static_cast<int>(std::floor(std::min(y1, y2))) - 1,
+            static_cast<int>(std::ceil(std::abs(x2 - x1))) + 3,
+            static_cast<int>(std::ceil(std::abs(y2 - y1))) + 3
+        };
+
+        uint64_t h = hashBytes(&cmd.p1, sizeof(cmd.p1));
+        h = hashBytes(&cmd.p2, sizeof(cmd.p2), h);
+        h = hashBytes(&color, sizeof(color), h);
+
+        record(bounds, h, commands.back());
+    }
+}
+
+
+
+void DrawList::setClipRect(const SDL_Rect* rect){
+    clipEnabled = (rect != nullptr);
+    if(rect != nullptr) clip = *rect;
+
+    if(immediate) SDL_SetRenderClipRect(Sys::renderer, rect);
+}
+
+
+
+void DrawList::issue(const Command& cmd){
+    if(cmd.kind == Kind::LINE){
+        SDL_SetRenderDrawColor(Sys::renderer, cmd.color);
+        SDL_RenderLine(Sys::renderer, cmd.p1.x, cmd.p1.y, cmd.p2.x, cmd.p2.y);
+        Sys::counters.lineCalls++;
+    } else {
+        SDL_RenderGeometry(
+            Sys::renderer,
+            cmd.texture,
+            vertices.data() + cmd.firstVertex,
+            cmd.numVertices,
+            indices.data() + cmd.firstIndex,
+            cmd.numIndices
+        );
+        Sys::counters.geometryCalls++;
+        Sys::counters.vertices += cmd.numVertices;
+        Sys::counters.indices += cmd.numIndices;
+    }
+
+    current.issuedCalls++;
+}
+
+
+
+void DrawList::replay(Replay which, SDL_Texture* window, const SDL_Rect* limit){
+    // Remember the renderer state, so it can be restored at the end
+    SDL_Texture* oldTarget = SDL_GetRenderTarget(Sys::renderer);
+    bool oldClipEnabled = SDL_RenderClipEnabled(Sys::renderer);
+    SDL_Rect oldClip = {0, 0, 0, 0};
+    if(oldClipEnabled) SDL_GetRenderClipRect(Sys::renderer, &oldClip);
+
+    SDL_Texture* target = oldTarget;
+    bool stateClipEnabled = oldClipEnabled;
+    SDL_Rect stateClip = oldClip;
+
+    for(const Command& cmd : commands){
+        bool isWindow = (cmd.target == nullptr);
+        if(which == Replay::TARGETS && isWindow) continue;
+        if(which == Replay::WINDOW && !isWindow) continue;
+
+        SDL_Texture* cmdTarget = isWindow ? window : cmd.target;
+        bool cmdClipEnabled = cmd.clipEnabled;
+        SDL_Rect cmdClip = cmd.clip;
+
+        // Only redraw what is inside of the limit
+        if(limit != nullptr && isWindow){
+            if(!SDL_HasRectIntersection(&cmd.bounds, limit)) continue;
+
+            if(!cmdClipEnabled) cmdClip = *limit;
+            else if(!SDL_GetRectIntersection(&cmd.clip, limit, &cmdClip)) continue;
+            cmdClipEnabled = true;
+        }
+
+        bool clipDirty = false;
+
+        // The clip rect belongs to the render target, so
+        // after switching the target it has to be set again
+        if(cmdTarget != target){
+            TM::setRenderTarget(cmdTarget);
+            target = cmdTarget;
+            clipDirty = true;
+        }
+
+        if(
+            clipDirty ||
+            cmdClipEnabled != stateClipEnabled ||
+            (cmdClipEnabled && !sameRect(cmdClip, stateClip))
+        ) {
+            SDL_SetRenderClipRect(Sys::renderer, cmdClipEnabled ? &cmdClip : nullptr);
+            stateClipEnabled = cmdClipEnabled;
+            stateClip = cmdClip;
+        }
+
+        issue(cmd);
+    }
+
+    // Restore the renderer state
+    if(target != oldTarget) TM::setRenderTarget(oldTarget);
+    SDL_SetRenderClipRect(Sys::renderer, oldClipEnabled ? &oldClip : nullptr);
+}
+
+
+
+void DrawList::flush(){
+    if(commands.empty()) return;
+    PROFILE_ZONE("DrawList::flush");
+
+    // With damage tracking the window commands have to wait for the
+    // end of the frame, only the ones drawing into textures are drawn
+    if(tracking()){
+        flushTargets();
+        return;
+    }
+
+    replay(Replay::ALL, nullptr, nullptr);
+
+    // Keep the capacity, it will be needed again next frame
+    commands.clear();
+    vertices.clear();
+    indices.clear();
+}
+
+
+
+void DrawList::flushTargets(){
+    bool hasTargets = false;
+    for(const Command& cmd : commands){
+        if(cmd.target != nullptr){ hasTargets = true; break; }
+    }
+    if(!hasTargets) return;
+
+    replay(Replay::TARGETS, nullptr, nullptr);
+
+    // Keep only the window commands, their vertices stay where they are
+    commands.erase(
+        std::remove_if(commands.begin(), commands.end(),
+            [](const Command& cmd){ return cmd.target != nullptr; }),
+        commands.end()
+    );
+}
+
+
+
+void DrawList::presentDamage(){
+    flushTargets();
+
+    int outW = 0, outH = 0;
+    SDL_GetCurrentRenderOutputSize(Sys::renderer, &outW, &outH);
+    SDL_Rect screen = {0, 0, outW, outH};
+
+    // BACK BUFFER ---------------------------------------------------------
+    // (Re)created on the first frame and whenever the window changes size
+    float bufW = 0, bufH = 0;
+    if(backBuffer != nullptr) SDL_GetTextureSize(backBuffer, &bufW, &bufH);
+
+    if(backBuffer == nullptr || int(bufW) != outW || int(bufH) != outH){
+        if(backBuffer != nullptr) TM::destroyTexture(backBuffer);
+
+        backBuffer = TM::createTexture(SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_TARGET, outW, outH);
+        if(backBuffer != nullptr) SDL_SetTextureBlendMode(backBuffer, SDL_BLENDMODE_NONE);
+        fullDamage = true;
+    }
+
+    // FIND THE DAMAGED REGIONS --------------------------------------------
+    vector<SDL_Rect> damage;
+
+    if(!fullDamage){
+        // Every record that didn't exist last frame, and every record
+        // from last frame that doesn't exist anymore, is damaged
+        unordered_map<uint64_t, int> previous;
+        previous.reserve(prevRecords.size());
+        for(const DamageRecord& r : prevRecords) previous[hashRect(r.hash, r.bounds)]++;
+
+        for(const DamageRecord& r : records){
+            auto it = previous.find(hashRect(r.hash, r.bounds));
+            if(it != previous.end() && it->second > 0) it->second--;
+            else addDamage(damage, r.bounds, screen);
+        }
+
+        for(const DamageRecord& r : prevRecords){
+            auto it = previous.find(hashRect(r.hash, r.bounds));
+            if(it->second > 0){
+                it->second--;
+                addDamage(damage, r.bounds, screen);
+            }
+        }
+
+        // Same primitives, but drawn in a different order
+        if(damage.empty() && sequenceHash != prevSequenceHash) fullDamage = true;
+    }
+
+    // Too many small regions cost more then one big one
+    if(damage.size() > 8){
+        SDL_Rect all = damage[0];
+        for(const SDL_Rect& d : damage) SDL_GetRectUnion(&all, &d, &all);
+        damage = { all };
+    }
+
+    if(fullDamage || backBuffer == nullptr) damage = { screen };
+
+    // REDRAW THE DAMAGED REGIONS ------------------------------------------
+    SDL_Texture* oldTarget = SDL_GetRenderTarget(Sys::renderer);
+    bool oldClipEnabled = SDL_RenderClipEnabled(Sys::renderer);
+    SDL_Rect oldClip = {0, 0, 0, 0};
+    if(oldClipEnabled) SDL_GetRenderClipRect(Sys::renderer, &oldClip);
+
+    SDL_BlendMode oldBlend = SDL_BLENDMODE_BLEND;
+    SDL_GetRenderDrawBlendMode(Sys::renderer, &oldBlend);
+
+    if(backBuffer != nullptr){
+        for(const SDL_Rect& d : damage){
+            // Clear the region, SDL_RenderClear would ignore the clip rect
+            TM::setRenderTarget(backBuffer);
+            SDL_SetRenderClipRect(Sys::renderer, nullptr);
+            SDL_SetRenderDrawBlendMode(Sys::renderer, SDL_BLENDMODE_NONE);
+            SDL_SetRenderDrawColor(Sys::renderer, Sys::clearColor);
+
+            SDL_FRect fd = TO_FRECT(d);
+            SDL_RenderFillRect(Sys::renderer, &fd);
+            Sys::counters.fillRectCalls++;
+            SDL_SetRenderDrawBlendMode(Sys::renderer, oldBlend);
+
+            replay(Replay::WINDOW, backBuffer, &d);
+
+            current.damagedArea += d.w * d.h;
+            current.damagedRects++;
+        }
+
+        // Copy the back buffer onto the window
+        TM::setRenderTarget(nullptr);
+        SDL_SetRenderClipRect(Sys::renderer, nullptr);
+        SDL_RenderTexture(Sys::renderer, backBuffer, nullptr, nullptr);
+        current.issuedCalls++;
+        Sys::counters.textureCalls++;
+    } else {
+        // Couldn't create the back buffer, draw everything directly
+        TM::setRenderTarget(nullptr);
+        SDL_SetRenderDrawColor(Sys::renderer, Sys::clearColor);
+        SDL_RenderClear(Sys::renderer);
+        Sys::counters.clearCalls++;
+        replay(Replay::WINDOW, nullptr, nullptr);
+
+        current.damagedArea += screen.w * screen.h;
+        current.damagedRects++;
+    }
+
+    TM::setRenderTarget(oldTarget);
+    SDL_SetRenderClipRect(Sys::renderer, oldClipEnabled ? &oldClip : nullptr);
+
+    // The records of this frame are compared against next frame
+    std::swap(records, prevRecords);
+    records.clear();
+    prevSequenceHash = sequenceHash;
+    sequenceHash = 0;
+    fullDamage = false;
+
+    commands.clear();
+    vertices.clear();
+    indices.clear();
+}
+
+
+
+void DrawList::record(const SDL_Rect& bounds, uint64_t hash, Command& cmd){
+    SDL_Rect visible = bounds;
+
+    // Clipped parts can't change anything
+    if(clipEnabled){
+        if(!SDL_GetRectIntersection(&bounds, &clip, &visible)) return;
+        hash = hashRect(hash, clip);
+    }
+
+    records.push_back({visible, hash});
+    sequenceHash = hashMix(hashRect(sequenceHash, visible), hash);
+
+    SDL_GetRectUnion(&cmd.bounds, &visible, &cmd.bounds);
+}
+
+
+
+void DrawList::endFrame(){
+    if(tracking()) presentDamage();
+    else flush();
+
+    last = current;
+    current = Stats();
+}
+
+
+
+bool DrawList::hasPending(){ return !commands.empty(); }
+
+void DrawList::setImmediateMode(bool value){
+    if(tracking()) presentDamage();
+    else flush();
+
+    immediate = value;
+    fullDamage = true;
+
+    if(immediate) SDL_SetRenderClipRect(Sys::renderer, clipEnabled ? &clip : nullptr);
+}
+
+bool DrawList::isImmediateMode(){ return immediate; }
+
+DrawList::Stats DrawList::getStats(){ return last; }
+
+
+
+bool DrawList::tracking(){ return damageTracking && !immediate; }
+
+void DrawList::setDamageTracking(bool enabled){
+    if(tracking()) presentDamage();
+    else flush();
+
+    damageTracking = enabled;
+    fullDamage = true;
+
+    if(!enabled){
+        records.clear();
+        prevRecords.clear();
+        textureGenerations.clear();
+
+        if(backBuffer != nullptr){
+            TM::destroyTexture(backBuffer);
+            backBuffer = nullptr;
+        }
+    }
+}
+
+bool DrawList::isDamageTracking(){ return damageTracking; }
+
+void DrawList::invalidate(){ fullDamage = true; }
+
+void DrawList::invalidateTexture(SDL_Texture* texture){
+    if(!damageTracking || texture == nullptr) return;
+    textureGenerations[texture] = ++generationCounter;
+}
+
+void DrawList::textureDestroyed(SDL_Texture* texture){
+    textureGenerations.erase(texture);
+    Sys::counters.texturesDestroyed++;
+}
@@ -0,0 +1,668 @@
+#include "gui.h"
+#include "../System/Sys.h"
+#include <fstream>
+
+
+
+// BAKED FILE -----------------------------------------------------------------
+// Written and read as they are in memory (little endian everywhere Lumos runs):
+//      Header
+//      PageRecord  x pageCount
+//      GlyphRecord x glyphCount
+//      KerningRecord x kerningCount
+//      pixels of every page, RGBA32, only the rows in use (usedHeight)
+static const char BAKED_MAGIC[8] = {'L', 'U', 'M', 'O', 'S', 'G', 'A', '1'};
+static const Uint32 BAKED_VERSION = 1;
+
+struct BakedHeader {
+    char magic[8];
+    Uint32 version;
+    Uint32 pageSize;
+    Uint64 fontHash;        // Sys::fontHash of the font it was baked from
+    Uint32 pageCount;
+    Uint32 glyphCount;
+    Uint32 kerningCount;
+    Uint32 reserved;
+};
+
+struct BakedPage {
+    Sint32 shelfX, shelfY, shelfHeight;
+    Sint32 usedHeight;
+};
+
+struct BakedGlyph {
+    Sint32 fontSize;
+    Uint32 codepoint;
+    Sint32 page;
+    Sint32 x, y, w, h;
+    Sint32 offsetX, offsetY, advance;
+};
+
+struct BakedKerning {
+    Sint32 fontSize;
+    Uint32 left, right;
+    Sint32 kerning;
+};
+
+static uint64_t kerningKey(int fontSize, Uint32 left, Uint32 right){
+    // Codepoints fit into 21 bits
+    return (uint64_t(fontSize & 0xffff) << 48) | (uint64_t(left & 0xffffff) << 24) | (right & 0xffffff);
+}
+
+
+
+void GlyphAtlas::setEnabled(bool value){ enabled = value; }
+bool GlyphAtlas::isEnabled(){ return enabled; }
+bool GlyphAtlas::hasBakedGlyphs(){ return !bakedSizes.empty(); }
+
+
+
+void GlyphAtlas::reset(){
+    glyphs.clear();
+    generation++;
+
+    // Pending commands might still be sampling the old pages,
+    // TM::destroyTexture waits for them to be drawn
+    for(Page& page : pages) if(page.texture) TM::destroyTexture(page.texture);
+    pages.clear();
+
+    Sys::unmapFile(baked);
+    bakedPixels.clear();
+    bakedSizes.clear();
+    kerning.clear();
+}
+
+
+
+void GlyphAtlas::clear(){ reset(); }
+
+
+
+bool GlyphAtlas::pack(Page& p, int w, int h, SDL_Rect& out){
+    // 1px gap between the glyphs, so linear filtering doesn't bleed the neighbours in
+    int pw = w + 1;
+    int ph = h + 1;
+    if(pw > PAGE_SIZE || ph > PAGE_SIZE) return false;
+
+    if(p.shelfX + pw > PAGE_SIZE){
+        p.shelfY += p.shelfHeight;
+        p.shelfX = 0;
+        p.shelfHeight = 0;
+    }
+    if(p.shelfY + ph > PAGE_SIZE) return false;
+
+    out = { p.shelfX, p.shelfY, w, h };
+    p.shelfX += pw;
+    p.shelfHeight = std::max(p.shelfHeight, ph);
+    return true;
+}
+
+
+
+bool GlyphAtlas::allocate(int w, int h, int& pageIndex, SDL_Rect& out){
+    if(w + 1 > PAGE_SIZE || h + 1 > PAGE_SIZE) return false;
+
+    // Shelf packing, try the pages that already exist first
+    for(size_t i = 0; i < pages.size(); i++){
+        if(!pack(pages[i], w, h, out)) continue;
+        pageIndex = static_cast<int>(i);
+        return true;
+    }
+
+    if((int)pages.size() >= MAX_PAGES) return false;
+
+    // NEW PAGE ----------------------------------------------------------------
+    SDL_Texture* tex = TM::createTexture(
+        SDL_PIXELFORMAT_RGBA32,
+        SDL_TEXTUREACCESS_STATIC,
+        PAGE_SIZE, PAGE_SIZE
+    );
+    if(tex == nullptr) return false;
+
+    SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_BLEND);
+    SDL_SetTextureScaleMode(tex, SDL_SCALEMODE_LINEAR);
+    TM::setTextureCategory(tex, TextureCategory::TEXT);
+
+    // The contents of a new texture are undefined, the gaps must be transparent
+    vector<Uint32> empty(PAGE_SIZE * PAGE_SIZE, 0);
+    TM::updateTexture(tex, nullptr, empty.data(), PAGE_SIZE * 4);
+
+    pages.push_back({ tex, 0, 0, 0 });
+    return allocate(w, h, pageIndex, out);
+}
+
+
+
+void GlyphAtlas::rasterize(
+    TTF_Font* font,
+    Uint32 codepoint,
+    Glyph& glyph,
+    vector<Uint8>& pixels,
+    int& w,
+    int& h
+) {
+    glyph = {};
+    glyph.page = -1;
+    w = h = 0;
+
+    int minX = 0, maxX = 0, minY = 0, maxY = 0;
+    TTF_GetGlyphMetrics(font, codepoint, &minX, &maxX, &minY, &maxY, &glyph.advance);
+
+    // White, the color comes from the vertices. The surface is laid out like a
+    // one character string, the pen starts after the negative left bearing
+    SDL_Surface* rendered = TTF_RenderGlyph_Blended(font, codepoint, SDL_COLOR_WHITE);
+    if(rendered == nullptr) return;
+
+    SDL_Surface* surface = SDL_ConvertSurface(rendered, SDL_PIXELFORMAT_RGBA32);
+    SDL_DestroySurface(rendered);
+    if(surface == nullptr) return;
+
+    int penStart = std::max(0, -minX);
+
+    // Only the part with some coverage is stored
+    int left = surface->w, right = -1, top = surface->h, bottom = -1;
+    for(int y = 0; y < surface->h; y++){
+        const Uint8* row = static_cast<const Uint8*>(surface->pixels) + y * surface->pitch;
+        for(int x = 0; x < surface->w; x++){
+            if(row[x * 4 + 3] == 0) continue;
+            left = std::min(left, x);
+            right = std::max(right, x);
+            top = std::min(top, y);
+            bottom = std::max(bottom, y);
+        }
+    }
+
+    if(right >= left){
+        w = right - left + 1;
+        h = bottom - top + 1;
+        glyph.offsetX = left - penStart;
+        glyph.offsetY = top;
+
+        pixels.resize(size_t(w) * h * 4);
+        for(int y = 0; y < h; y++){
+            const Uint8* row = static_cast<const Uint8*>(surface->pixels) + (top + y) * surface->pitch + left * 4;
+            memcpy(pixels.data() + size_t(y) * w * 4, row, size_t(w) * 4);
+        }
+    }
+
+    SDL_DestroySurface(surface);
+}
+
+
+
+const GlyphAtlas::Glyph* GlyphAtlas::getGlyph(TTF_Font* font, int fontSize, Uint32 codepoint){
+    GlyphKey key = { fontSize, codepoint };
+
+    auto it = glyphs.find(key);
+    if(it != glyphs.end()) return &it->second;
+
+    // RASTERIZE -----------------------------------------------------------------
+    static vector<Uint8> pixels;
+    Glyph glyph;
+    int w = 0, h = 0;
+    rasterize(font, codepoint, glyph, pixels, w, h);
+
+    if(w > 0){
+        if(!allocate(w, h, glyph.page, glyph.rect)){
+            // Every page is full, start over. The caller has to collect
+            // its glyphs again as the old ones are gone (see generation)
+            reset();
+            if(!allocate(w, h, glyph.page, glyph.rect)) glyph.page = -1;
+        }
+
+        if(glyph.page != -1 && pages[glyph.page].texture != nullptr){
+            TM::updateTexture(pages[glyph.page].texture, &glyph.rect, pixels.data(), w * 4);
+        }
+    }
+
+    return &glyphs.emplace(key, glyph).first->second;
+}
+
+
+
+int GlyphAtlas::getKerning(TTF_Font* font, int fontSize, Uint32 left, Uint32 right){
+    // Baked sizes store every pair of baked glyphs that has kerning, the rest
+    // of those pairs have none. Glyphs rasterized later ask FreeType
+    if(bakedSizes.count(fontSize)){
+        auto l = glyphs.find({fontSize, left});
+        auto r = glyphs.find({fontSize, right});
+
+        if(l != glyphs.end() && l->second.baked && r != glyphs.end() && r->second.baked){
+            auto it = kerning.find(kerningKey(fontSize, left, right));
+            return (it != kerning.end()) ? it->second : 0;
+        }
+    }
+
+    int k = 0;
+    if(!TTF_GetGlyphKerning(font, left, right, &k)) return 0;
+    return k;
+}
+
+
+
+bool GlyphAtlas::measure(const string& text, int fontSize, int& width, int& height){
+    if(Sys::fontPath == "" || fontSize < 1) return false;
+
+    GUI::TextMetrics m = GUI::measureText(text, fontSize);
+    if(m.lineHeight <= 0) return false;
+
+    width = m.width;
+    height = std::max(m.height, m.lineHeight);
+    return true;
+}
+
+
+
+bool GlyphAtlas::draw(
+    const string& text,
+    int fontSize,
+    const SDL_FRect& dst,
+    const SDL_Color& color
+) {
+    if(!enabled || text.empty()) return false;
+    uploadBaked();
+
+    int width = 0, height = 0;
+    if(!measure(text, fontSize, width, height) || width <= 0 || height <= 0) return false;
+    TTF_Font* font = Sys::getFont(fontSize);
+
+    // LAYOUT --------------------------------------------------------------------
+    // If the atlas gets reset while collecting, the glyphs collected
+    // before are gone, so the whole line is collected again
+    for(int attempt = 0; attempt < 2; attempt++){
+        Uint64 gen = generation;
+        line.clear();
+        penX.clear();
+
+        const char* p = text.c_str();
+        size_t left = text.size();
+        Uint32 previous = 0;
+        int pen = 0;
+
+        while(left > 0){
+            Uint32 cp = SDL_StepUTF8(&p, &left);
+            if(cp == 0) break;
+
+            if(previous != 0) pen += getKerning(font, fontSize, previous, cp);
+
+            const Glyph* g = getGlyph(font, fontSize, cp);
+            line.push_back(g);
+            penX.push_back(pen);
+
+            pen += g->advance;
+            previous = cp;
+        }
+
+        if(gen == generation) break;
+        if(attempt == 1) return false;
+    }
+
+    // Like TTF_RenderText_Blended, nothing can stick out on the left
+    int shift = 0;
+    for(size_t i = 0; i < line.size(); i++){
+        if(line[i]->page != -1) shift = std::max(shift, -(penX[i] + line[i]->offsetX));
+    }
+
+    // Stretched into dst the same way the text texture would be
+    for(int& x : penX) x += shift;
+    emitQuads(dst.x, dst.y, dst.w / width, dst.h / height, color);
+
+    return true;
+}
+
+
+
+void GlyphAtlas::emitQuads(float x, float y, float sx, float sy, const SDL_Color& color){
+    float inv = 1.0f / PAGE_SIZE;
+    SDL_FColor fcol = TO_FCOLOR(color);
+
+    for(size_t page = 0; page < pages.size(); page++){
+        scratchVertices.clear();
+        scratchIndices.clear();
+
+        for(size_t i = 0; i < line.size(); i++){
+            const Glyph* g = line[i];
+            if(g->page != (int)page) continue;
+
+            float x0 = x + (penX[i] + g->offsetX) * sx;
+            float y0 = y + g->offsetY * sy;
+            float x1 = x0 + g->rect.w * sx;
+            float y1 = y0 + g->rect.h * sy;
+
+            float u0 = g->rect.x * inv;
+            float v0 = g->rect.y * inv;
+            float u1 = (g->rect.x + g->rect.w) * inv;
+            float v1 = (g->rect.y + g->rect.h) * inv;
+
+            int base = static_cast<int>(scratchVertices.size());
+            scratchVertices.push_back({ { x0, y0 }, fcol, { u0, v0 } });
+            scratchVertices.push_back({ { x1, y0 }, fcol, { u1, v0 } });
+            scratchVertices.push_back({ { x1, y1 }, fcol, { u1, v1 } });
+            scratchVertices.push_back({ { x0, y1 }, fcol, { u0, v1 } });
+
+            const int quad[6] = { 0, 1, 2, 0, 2, 3 };
+            for(int q : quad) scratchIndices.push_back(base + q);
+        }
+
+        if(scratchVertices.empty() || pages[page].texture == nullptr) continue;
+
+        DrawList::geometry(
+            pages[page].texture,
+            scratchVertices.data(), static_cast<int>(scratchVertices.size()),
+            scratchIndices.data(), static_cast<int>(scratchIndices.size())
+        );
+    }
+}
+
+
+
+// GLYPH RUNS -----------------------------------------------------------------
+void GlyphAtlas::layout(
+    const string& text,
+    int fontSize,
+    vector<Uint32>& codepoints,
+    vector<int>& carets
+) {
+    if(text.empty()) return;
+    TTF_Font* font = Sys::getFont(fontSize);
+    if(font == nullptr) return;
+
+    // Continues after whatever is already laid out
+    Uint32 previous = codepoints.empty() ? 0 : codepoints.back();
+    int pen = carets.empty() ? 0 : carets.back();
+
+    const char* p = text.c_str();
+    size_t left = text.size();
+
+    while(left > 0){
+        Uint32 cp = SDL_StepUTF8(&p, &left);
+        if(cp == 0) break;
+
+        if(previous != 0) pen += getKerning(font, fontSize, previous, cp);
+
+        // Only the advance is needed, so glyphs that aren't in the atlas
+        // yet don't get rasterized (the atlas might be off too)
+        auto it = glyphs.find({ fontSize, cp });
+        int advance = 0;
+        if(it != glyphs.end()) advance = it->second.advance;
+        else TTF_GetGlyphMetrics(font, cp, nullptr, nullptr, nullptr, nullptr, &advance);
+
+        pen += advance;
+        codepoints.push_back(cp);
+        carets.push_back(pen);
+        previous = cp;
+    }
+}
+
+
+
+bool GlyphAtlas::drawRun(
+    const vector<Uint32>& codepoints,
+    const vector<int>& carets,
+    size_t first,
+    size_t last,
+    int fontSize,
+    SDL_FPoint origin,
+    float scale,
+    const SDL_Color& color
+) {
+    if(!enabled) return false;
+    last = std::min(last, codepoints.size());
+    if(first >= last) return true;
+
+    uploadBaked();
+    TTF_Font* font = Sys::getFont(fontSize);
+    if(font == nullptr) return false;
+
+    // Same as in draw, a reset while collecting means collecting again
+    for(int attempt = 0; attempt < 2; attempt++){
+        Uint64 gen = generation;
+        line.clear();
+        penX.clear();
+
+        for(size_t i = first; i < last; i++){
+            // The caret before the glyph, moved by the kerning of the pair
+            int pen = (i == 0) ? 0 : carets[i - 1];
+            if(i > 0) pen += getKerning(font, fontSize, codepoints[i - 1], codepoints[i]);
+
+            line.push_back(getGlyph(font, fontSize, codepoints[i]));
+            penX.push_back(pen);
+        }
+
+        if(gen == generation) break;
+        if(attempt == 1) return false;
+    }
+
+    emitQuads(origin.x, origin.y, scale, scale, color);
+    return true;
+}
+
+
+
+// BAKING -------------------------------------------------------------------------
+int GlyphAtlas::bake(
+    const string& path,
+    const vector<int>& sizes,
+    const string& glyphs
+) {
+    PROFILE_ZONE("GlyphAtlas::bake");
+    if(Sys::fontFile.data == nullptr) return SYS_FONT_NOT_INITED;
+
+    // Everything is packed on the CPU, no renderer needed
+    vector<Page> bakePages;
+    vector<vector<Uint8>> bakePixels;
+    vector<BakedGlyph> bakeGlyphs;
+    vector<BakedKerning> bakeKerning;
+
+    // Codepoints of the glyphset, without duplicates
+    vector<Uint32> codepoints;
+    const char* p = glyphs.c_str();
+    size_t left = glyphs.size();
+    while(left > 0){
+        Uint32 cp = SDL_StepUTF8(&p, &left);
+        if(cp == 0) break;
+        if(std::find(codepoints.begin(), codepoints.end(), cp) == codepoints.end()) codepoints.push_back(cp);
+    }
+
+    vector<Uint8> pixels;
+    for(int size : sizes){
+        TTF_Font* font = Sys::getFont(size);
+        if(font == nullptr) continue;
+
+        for(Uint32 cp : codepoints){
+            Glyph glyph;
+            int w = 0, h = 0;
+            rasterize(font, cp, glyph, pixels, w, h);
+
+            if(w > 0){
+                size_t i = 0;
+                for(; i < bakePages.size(); i++) if(pack(bakePages[i], w, h, glyph.rect)) break;
+
+                if(i == bakePages.size()){
+                    if((int)bakePages.size() >= MAX_PAGES) continue;    // Full, this one is rendered at runtime
+                    bakePages.push_back({nullptr, 0, 0, 0});
+                    bakePixels.emplace_back(size_t(PAGE_SIZE) * PAGE_SIZE * 4, 0);
+                    if(!pack(bakePages[i], w, h, glyph.rect)) continue;
+                }
+
+                glyph.page = static_cast<int>(i);
+                for(int y = 0; y < h; y++){
+                    memcpy(
+                        bakePixels[i].data() + (size_t(glyph.rect.y + y) * PAGE_SIZE + glyph.rect.x) * 4,
+                        pixels.data() + size_t(y) * w * 4,
+                        size_t(w) * 4
+                    );
+                }
+            }
+
+            bakeGlyphs.push_back({
+                size, cp, glyph.page,
+                glyph.rect.x, glyph.rect.y, glyph.rect.w, glyph.rect.h,
+                glyph.offsetX, glyph.offsetY, glyph.advance
+            });
+        }
+
+        // Only the pairs that actually have kerning
+        for(Uint32 a : codepoints){
+            for(Uint32 b : codepoints){
+                int k = 0;
+                if(TTF_GetGlyphKerning(font, a, b, &k) && k != 0) bakeKerning.push_back({size, a, b, k});
+            }
+        }
+    }
+
+    // WRITE ------------------------------------------------------------------------
+    std::ofstream out(path, std::ios::binary);
+    if(!out.is_open()) return SYS_GLYPH_ATLAS_IO_ERROR;
+
+    BakedHeader header = {};
+    memcpy(header.magic, BAKED_MAGIC, sizeof(BAKED_MAGIC));
+    header.version = BAKED_VERSION;
+    header.pageSize = PAGE_SIZE;
+    header.fontHash = Sys::fontHash;
+    header.pageCount = static_cast<Uint32>(bakePages.size());
+    header.glyphCount = static_cast<Uint32>(bakeGlyphs.size());
+    header.kerningCount = static_cast<Uint32>(bakeKerning.size());
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    for(const Page& page : bakePages){
+        BakedPage bp = { page.shelfX, page.shelfY, page.shelfHeight, page.shelfY + page.shelfHeight };
+        out.write(reinterpret_cast<const char*>(&bp), sizeof(bp));
+    }
+    out.write(reinterpret_cast<const char*>(bakeGlyphs.data()), bakeGlyphs.size() * sizeof(BakedGlyph));
+    out.write(reinterpret_cast<const char*>(bakeKerning.data()), bakeKerning.size() * sizeof(BakedKerning));
+
+    for(size_t i = 0; i < bakePages.size(); i++){
+        int usedHeight = bakePages[i].shelfY + bakePages[i].shelfHeight;
+        out.write(reinterpret_cast<const char*>(bakePixels[i].data()), size_t(usedHeight) * PAGE_SIZE * 4);
+    }
+
+    out.close();
+    if(!out.good()) return SYS_GLYPH_ATLAS_IO_ERROR;
+
+    return load(path);
+}
+
+
+
+// LOADING ------------------------------------------------------------------------
+int GlyphAtlas::load(const string& path){
+    PROFILE_ZONE("GlyphAtlas::load");
+    reset();
+
+    if(!Sys::mapFile(path, baked)) return SYS_GLYPH_ATLAS_IO_ERROR;
+    const Uint8* data = static_cast<const Uint8*>(baked.data);
+    size_t size = baked.size;
+
+    // VALIDATE ---------------------------------------------------------------------
+    BakedHeader header;
+    if(size < sizeof(header)){ reset(); return SYS_GLYPH_ATLAS_INVALID; }
+    memcpy(&header, data, sizeof(header));
+
+    bool valid =
+        memcmp(header.magic, BAKED_MAGIC, sizeof(BAKED_MAGIC)) == 0 &&
+        header.version == BAKED_VERSION &&
+        header.pageSize == Uint32(PAGE_SIZE) &&
+        header.fontHash == Sys::fontHash &&
+        header.pageCount <= Uint32(MAX_PAGES);
+    if(!valid){ reset(); return SYS_GLYPH_ATLAS_INVALID; }
+
+    size_t offset = sizeof(header);
+    size_t tables =
+        header.pageCount * sizeof(BakedPage) +
+        size_t(header.glyphCount) * sizeof(BakedGlyph) +
+        size_t(header.kerningCount) * sizeof(BakedKerning);
+    if(size - offset < tables){ reset(); return SYS_GLYPH_ATLAS_INVALID; }
+
+    // PAGES, the pixels stay in the file until the first draw -----------------------
+    size_t pixelsOffset = offset + tables;
+    for(Uint32 i = 0; i < header.pageCount; i++){
+        BakedPage bp;
+        memcpy(&bp, data + offset + i * sizeof(BakedPage), sizeof(bp));
+
+        // The shelves have to describe the rows in the file, so packing more
+        // glyphs into the page later doesn't go past them
+        bool validPage =
+            bp.shelfX >= 0 && bp.shelfX <= PAGE_SIZE &&
+            bp.shelfY >= 0 && bp.shelfHeight >= 0 &&
+            bp.usedHeight <= PAGE_SIZE &&
+            Sint64(bp.shelfY) + bp.shelfHeight == bp.usedHeight;
+        if(!validPage){ reset(); return SYS_GLYPH_ATLAS_INVALID; }
+
+        size_t bytes = size_t(bp.usedHeight) * PAGE_SIZE * 4;
+        if(size - pixelsOffset < bytes){ reset(); return SYS_GLYPH_ATLAS_INVALID; }
+
+        pages.push_back({nullptr, bp.shelfX, bp.shelfY, bp.shelfHeight});
+        bakedPixels.push_back({pixelsOffset, bp.usedHeight});
+        pixelsOffset += bytes;
+    }
+    offset += header.pageCount * sizeof(BakedPage);
+
+    // GLYPHS ---------------------------------------------------------------------
+    for(Uint32 i = 0; i < header.glyphCount; i++){
+        BakedGlyph bg;
+        memcpy(&bg, data + offset, sizeof(bg));
+        offset += sizeof(bg);
+
+        // -1 are glyphs without pixels, the rest has to be inside of its page
+        bool validGlyph = bg.page == -1 || (
+            bg.page >= 0 && bg.page < (int)header.pageCount &&
+            bg.x >= 0 && bg.y >= 0 && bg.w >= 0 && bg.h >= 0 &&
+            Sint64(bg.x) + bg.w <= PAGE_SIZE && Sint64(bg.y) + bg.h <= PAGE_SIZE
+        );
+        if(!validGlyph){ reset(); return SYS_GLYPH_ATLAS_INVALID; }
+
+        Glyph glyph = { bg.page, {bg.x, bg.y, bg.w, bg.h}, bg.offsetX, bg.offsetY, bg.advance, true };
+        glyphs.insert({ {bg.fontSize, bg.codepoint}, glyph });
+        bakedSizes.insert(bg.fontSize);
+    }
+
+    // KERNING --------------------------------------------------------------------
+    for(Uint32 i = 0; i < header.kerningCount; i++){
+        BakedKerning bk;
+        memcpy(&bk, data + offset, sizeof(bk));
+        offset += sizeof(bk);
+
+        kerning[kerningKey(bk.fontSize, bk.left, bk.right)] = bk.kerning;
+    }
+
+    return NO_ERROR;
+}
+
+
+
+void GlyphAtlas::uploadBaked(){
+    if(baked.data == nullptr) return;
+    PROFILE_ZONE("GlyphAtlas::uploadBaked");
+
+    const Uint8* data = static_cast<const Uint8*>(baked.data);
+    vector<Uint8> empty;
+
+    for(size_t i = 0; i < pages.size(); i++){
+        Page& page = pages[i];
+        if(page.texture != nullptr) continue;
+
+        page.texture = TM::createTexture(SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, PAGE_SIZE, PAGE_SIZE);
+        if(page.texture == nullptr) continue;
+
+        SDL_SetTextureBlendMode(page.texture, SDL_BLENDMODE_BLEND);
+        SDL_SetTextureScaleMode(page.texture, SDL_SCALEMODE_LINEAR);
+        TM::setTextureCategory(page.texture, TextureCategory::TEXT);
+
+        // The rows in use come from the file, the rest is transparent
+        int usedHeight = bakedPixels[i].usedHeight;
+        if(usedHeight > 0){
+            SDL_Rect used = {0, 0, PAGE_SIZE, usedHeight};
+            TM::updateTexture(page.texture, &used, data + bakedPixels[i].offset, PAGE_SIZE * 4);
+        }
+        if(usedHeight < PAGE_SIZE){
+            empty.assign(size_t(PAGE_SIZE) * (PAGE_SIZE - usedHeight) * 4, 0);
+            SDL_Rect rest = {0, usedHeight, PAGE_SIZE, PAGE_SIZE - usedHeight};
+            TM::updateTexture(page.texture, &rest, empty.data(), PAGE_SIZE * 4);
+        }
+    }
+
+    // Everything is on the GPU now
+    Sys::unmapFile(baked);
+    bakedPixels.clear();
+}
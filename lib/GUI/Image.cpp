@@ -6,6 +6,17 @@
 void GUI::Image(
     SDL_Texture* texture,
     SDL_Rect& dr_org
+) {
+    Image(texture, nullptr, dr_org);
+}
+
+
+
+void GUI::Image(
+    SDL_Texture* texture,
+    const SDL_Rect* srcRect,
+    SDL_Rect& dr_org,
+    const SDL_Color& tint
 ) {
     // ===== CREATE FRECT ===== ===== =====
     SDL_FRect dr = {
@@ -32,9 +43,13 @@ void GUI::Image(
     int texWidth = (int)SDL_GetNumberProperty(prop, SDL_PROP_TEXTURE_WIDTH_NUMBER, 0);
     int texHeight = (int)SDL_GetNumberProperty(prop, SDL_PROP_TEXTURE_HEIGHT_NUMBER, 0);
 
+    // ===== SOURCE, THE WHOLE TEXTURE BY DEFAULT ===== ===== =====
+    SDL_FRect src = srcRect ? TO_FRECT(*srcRect) : SDL_FRect{0, 0, (float)texWidth, (float)texHeight};
+    const SDL_FRect* srcFull = srcRect ? &src : nullptr;
+
     // ===== UPDATE MISSING DIMENSIONS ===== ===== =====
-    if(dr.w == -1) dr.w = dr.h * (float)texWidth / texHeight;
-    if(dr.h == -1) dr.h = dr.w * (float)texHeight / texWidth;
+    if(dr.w == -1) dr.w = dr.h * src.w / src.h;
+    if(dr.h == -1) dr.h = dr.w * src.h / src.w;
 
     dr_org.w = static_cast<int>(dr.w);
     dr_org.h = static_cast<int>(dr.h);
@@ -44,13 +59,7 @@ void GUI::Image(
     // ===== IF THERE ARE NO ACTIVE CONTAINERS ===== ===== =====
     if(activeContainer.empty()){
 
-        int err = SDL_RenderTexture(Sys::renderer, texture, NULL, &dr);
-
-        if(!err) {
-            Sys::printf_err("[GUI::Image(SDL_Texture*)] SDL_RenderTexture Failed: ");
-            Sys::printf_err(SDL_GetError());
-        }
-
+        DrawList::texture(texture, srcFull, dr, tint);
         return;
     }
 
@@ -72,7 +81,7 @@ void GUI::Image(
         };
 
         // RENDER
-        SDL_RenderTexture(Sys::renderer, texture, NULL, &absoluteRect);
+        DrawList::texture(texture, srcFull, absoluteRect, tint);
         
         return;
     }
@@ -92,14 +101,14 @@ void GUI::Image(
             static_cast<float>(visiblePart)
         };
 
-        SDL_FRect srcRect = {
-            static_cast<float>(0),
-            static_cast<float>(texHeight * static_cast<float>(invisiblePart) / dr.h),
-            static_cast<float>(texWidth),
-            static_cast<float>(texHeight * static_cast<float>(visiblePart) / dr.h)
+        SDL_FRect visibleSrc = {
+            src.x,
+            src.y + src.h * static_cast<float>(invisiblePart) / dr.h,
+            src.w,
+            src.h * static_cast<float>(visiblePart) / dr.h
         };
 
-        SDL_RenderTexture(Sys::renderer, texture, &srcRect, &absoluteRect);
+        DrawList::texture(texture, &visibleSrc, absoluteRect, tint);
         return;
     }
 
@@ -118,14 +127,14 @@ void GUI::Image(
             visiblePart
         };
 
-        SDL_FRect srcRect = {
-            0,
-            0,
-            static_cast<float>(texWidth),
-            static_cast<float>(texHeight * visiblePart / dr.h)
+        SDL_FRect visibleSrc = {
+            src.x,
+            src.y,
+            src.w,
+            src.h * visiblePart / dr.h
         };
 
-        SDL_RenderTexture(Sys::renderer, texture, &srcRect, &absoluteRect);
+        DrawList::texture(texture, &visibleSrc, absoluteRect, tint);
         return;
     }
 }
@@ -139,7 +148,8 @@ void GUI::Image(
     TextureData& td, 
     SDL_Rect& dr_org
 ) {
-    Image(td.getTexture(), dr_org);
+    // Loads it again if it was evicted to stay in the texture budget
+    Image(TM::useTexture(td), dr_org);
 }
 
 
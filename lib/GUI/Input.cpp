@@ -1,6 +1,9 @@
 #include "gui.h"
 #include "../System/Sys.h"
 
+// Held backspace deletes after BACKSPACE_REPEAT_DELAY, then every BACKSPACE_REPEAT_RATE (ms)
+static const Uint64 BACKSPACE_REPEAT_DELAY = 400;
+static const Uint64 BACKSPACE_REPEAT_RATE = 35;
 
 
 
@@ -27,14 +30,15 @@ string GUI::Input(
     const SDL_Color& background,
     const SDL_Color& foreground
 ){  
+    PROFILE_ZONE("GUI::Input");
+
     /**
      * Improvements:
      *      - Char Position changer, like give the arrows some functionality
      *        left and right curosr movement, on each focus it should be set to
      *        max, the last char, but also make it changable using arrows and even
      *        with mouse click, advanced
-     *        ! Problem: Each char should then be treated individualy as the program
-     *                   must known where to draw the caret, where each char begins
+     *        The carets of every char are already in state->carets
      */
 
 
@@ -142,8 +146,39 @@ string GUI::Input(
         textRect.h = fontSize;
     }
 
+    // LAYOUT ----------------------------------------------------------
+    // The advances of the value are laid out once and then only what gets
+    // typed is added, so a keystroke doesn't depend on the length of the value
+    if(state->layoutSize != textRect.h){
+        state->glyphs.clear();
+        state->carets.clear();
+        GlyphAtlas::layout(state->value, textRect.h, state->glyphs, state->carets);
+
+        // Like a text texture, the whole line is stretched into textRect.h
+        int lineHeight = measureText("", textRect.h).lineHeight;
+        state->layoutScale = (lineHeight > 0) ? float(textRect.h) / lineHeight : 1.f;
+        state->layoutSize = textRect.h;
+        state->change = true;
+    }
+
+    // Check if placeholder was rendered
+    bool placeholderActive = false;
+    if(state->value == "") placeholderActive = true;
+
     // TEXT RECT WIDTH ---------------------------------------------------
-    textRect.w = textRect.h * (float)state->td.getWidth() / state->td.getHeight();
+    // When the text is wider then the field its start is scrolled out on
+    // the left, so the end with the caret stays vissible
+    int availableWidth = dRect.w - paddingRect.left - paddingRect.right;
+    int textWidth = 0;
+    int scrollX = 0;
+
+    if(placeholderActive){
+        textRect.w = placeholder.empty() ? 0 : calcTextWidth(placeholder, textRect.h);
+    } else {
+        if(!state->carets.empty()) textWidth = static_cast<int>(state->carets.back() * state->layoutScale + 0.5f);
+        scrollX = std::max(0, textWidth - availableWidth);
+        textRect.w = textWidth - scrollX;
+    }
 
     // TEXT RECT X POS ---------------------------------------------------
     // Depending on the placement, left, center, right. Default: left
@@ -167,22 +202,30 @@ string GUI::Input(
 
 
     // Render the text
-    GUI::Image(state->td, textRect);
-
-    if(inputLock) GUI::Rect(dRect, {120, 120, 120, 120});
-
-    // Check if placeholder was rendered
-    bool placeholderActive = false;
-    if(state->value == "") placeholderActive = true;
+    if(placeholderActive){
+        SDL_Color placeholderColor = foreground;
+        placeholderColor.a *= 0.75;
+        if(!placeholder.empty()) GUI::Text(placeholder, textRect, placeholderColor);
+    } else if(!drawGlyphRun(state->glyphs, state->carets, state->layoutSize, state->layoutScale, textRect, scrollX, foreground)){
+        // No atlas, the whole value is rendered once per change
+        // and only the vissible part of it is drawn
+        if(state->change || state->td.getTexture() == nullptr){
+            int err = TM::createTextTexture(state->td, state->value, textRect.h, SDL_COLOR_WHITE);
+            CHECK_ERROR(err);
+        }
 
-    // If the rendered text is larger then the allowed width
-    // and we are also not talking about the placeholder THEN
-    // make the removed variable larger by one, signaling to the
-    // next frame that it should cut out one more frame from the left
-    if(textRect.w > (dRect.w - paddingRect.left - paddingRect.right) && !placeholderActive){
-        state->removed++;
-        state->change = true;
+        float scale = state->layoutScale;
+        SDL_Rect src = {
+            static_cast<int>(scrollX / scale),
+            0,
+            static_cast<int>(textRect.w / scale),
+            state->td.getHeight()
+        };
+        GUI::Image(state->td.getTexture(), &src, textRect, foreground);
     }
+    state->change = false;
+
+    if(inputLock) GUI::Rect(dRect, {120, 120, 120, 120});
 
 
 
@@ -190,8 +233,12 @@ string GUI::Input(
     if(state->focused){
         // The cursor would be drawn for half a second and then be not drawn for 
         // another half a second, this is acheved trough clock which changes value
-        // every (FPS / 2)frames so it can be devieded using %2 operator
-        int blinkClock = static_cast<int>( Sys::getCurrentFrame() / (Sys::FPS / 2) );
+        // every 500ms so it can be devieded using %2 operator. Its based on time
+        // and not frames, so in idle mode a wake-up is requested for the next change
+        Uint64 ticks = SDL_GetTicks();
+        Sys::requestWakeUp(static_cast<Uint32>(500 - ticks % 500));
+
+        int blinkClock = static_cast<int>(ticks / 500);
         if(blinkClock % 2){
             // Top point of the line, default the
             // x is equal to the starting position of the text
@@ -255,12 +302,16 @@ string GUI::Input(
         // If value is already empty skip
         if (state->value.empty()) return;
 
-        // Pop last char and mark change has been made
+        // Pop the whole last char, it can take up to 4 bytes in UTF-8
+        while(state->value.size() > 1 && (state->value.back() & 0xC0) == 0x80) state->value.pop_back();
         state->value.pop_back();
         state->change = true;
 
-        // If there was any chars to be removed, decrease the amount
-        if (state->removed != 0) state->removed--;
+        // Its caret goes with it, the rest of the layout stays
+        if(!state->glyphs.empty()){
+            state->glyphs.pop_back();
+            state->carets.pop_back();
+        }
     };
 
     // If the input is focused handle key presses
@@ -269,6 +320,11 @@ string GUI::Input(
         if(Keyboard::getText() != "") {
             state->change = true;
             state->value += Keyboard::getText();
+
+            // Only the new chars are laid out
+            if(state->layoutSize != 0){
+                GlyphAtlas::layout(Keyboard::getText(), state->layoutSize, state->glyphs, state->carets);
+            }
         }
 
         // If the backspace has been pressed handle deletion
@@ -277,15 +333,22 @@ string GUI::Input(
             // that menas that this is the first frame that
             // backspace was pressed, so delete the last char
             // and mark that the hold of the button has begun
+            // Frames have to keep coming while its held, even in idle mode
+            Sys::requestWakeUp();
+
+            Uint64 now = SDL_GetTicks();
             if(!state->deleting){
                 deleteLastChar();
                 state->deleting = true;
+                state->deleteAt = now + BACKSPACE_REPEAT_DELAY;
             } else{
                 // If the deletion has been going, and the
-                // backspace is still down, holding, every
-                // 200ms delete one last char from the field
-                if(Sys::getCurrentFrame() % (Sys::FPS / 5)){
+                // backspace is still down, holding, delete
+                // one last char every BACKSPACE_REPEAT_RATE.
+                // By time, not frames, FPS can be 0 (unlimited)
+                if(now >= state->deleteAt){
                     deleteLastChar();
+                    state->deleteAt = now + BACKSPACE_REPEAT_RATE;
                 }
             }
         } else{
@@ -294,30 +357,6 @@ string GUI::Input(
         }
     }
 
-    // Now handle the value changes and updating the texture
-    if(state->change){
-        state->td.setTexture(nullptr);
-        
-        string textToCompile;
-        SDL_Color colorOfText = foreground;
-        if(state->value == ""){
-            colorOfText.a *= 0.75;
-            textToCompile = placeholder;
-        } else {
-            // So bc text can get longer then it can fit in the field
-            // program also keeps track of how many characters it needs
-            // to hide from the left side in order for text from the right
-            // side to be vissible and with in the bounds
-            textToCompile = state->value;
-            textToCompile.erase(0, state->removed);
-        }
-
-        int err = TM::createTextTexture(state->td, textToCompile, textRect.h, colorOfText);
-        CHECK_ERROR(err);
-         
-        state->change = false;
-    }
-
     if(state->firstRender) state->firstRender = false;
 
     // Return the value
@@ -16,8 +16,7 @@
 void drawThickLineSegment(const SDL_Point& p1, const SDL_Point& p2, const SDL_Color& color, int thickness) {
     // For a thickness of 1, we can simply draw a normal line.
     if (thickness <= 1) {
-        SDL_SetRenderDrawColor(Sys::renderer, color);
-        SDL_RenderLine(Sys::renderer, p1.x, p1.y, p2.x, p2.y);
+        DrawList::line(p1.x, p1.y, p2.x, p2.y, color);
         return;
     }
 
@@ -61,7 +60,7 @@ void drawThickLineSegment(const SDL_Point& p1, const SDL_Point& p2, const SDL_Co
     vertices[3].tex_coord = { 0.f, 0.f };
 
     int indices[6] = { 0, 1, 2, 0, 2, 3 };
-    SDL_RenderGeometry(Sys::renderer, nullptr, vertices, 4, indices, 6);
+    DrawList::geometry(nullptr, vertices, 4, indices, 6);
 }
 
 
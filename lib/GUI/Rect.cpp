@@ -6,158 +6,6 @@
 
 
 
-/**
- * Draws a filled rounded rectangle.
- *
- * @param renderer     Your SDL_Renderer*.
- * @param rect         The rectangle (x,y,w,h).
- * @param radius       Corner radius in pixels (clamped to half-width/height).
- * @param color        Fill color.
- * @param segments     How many segments per corner (8–16 is usually plenty).
- */
-void drawRoundedFilledRect(
-    SDL_Rect         rect,
-    unsigned int     radius,
-    SDL_Color        color,
-    int              segments = 12
-) {
-    // Clamp radius so corners never overlap
-    radius = std::min<unsigned>(radius, rect.w/2u);
-    radius = std::min<unsigned>(radius, rect.h/2u);
-
-    // Precompute normalized color
-    SDL_FColor fcol = {
-        color.r / 255.0f,
-        color.g / 255.0f,
-        color.b / 255.0f,
-        color.a / 255.0f
-    };
-
-    // 1) Fill center rectangle
-    SDL_FRect r = {
-        float(rect.x + radius),
-        float(rect.y),
-        float(rect.w - 2*radius),
-        float(rect.h)
-    };
-    SDL_SetRenderDrawColor(Sys::renderer, color.r, color.g, color.b, color.a);
-    SDL_RenderFillRect(Sys::renderer, &r);
-
-    // 2) Fill left and right side strips
-    r = {
-        float(rect.x),
-        float(rect.y + radius),
-        float(radius),
-        float(rect.h - 2*radius)
-    };
-    SDL_RenderFillRect(Sys::renderer, &r);
-
-    r = {
-        float(rect.x + rect.w - radius),
-        float(rect.y + radius),
-        float(radius),
-        float(rect.h - 2*radius)
-    };
-    SDL_RenderFillRect(Sys::renderer, &r);
-
-    // Helper to build a corner fan
-    auto drawCorner = [&](float cx, float cy, float startDeg){
-        // Build triangle‐fan vertices
-        std::vector<SDL_Vertex> verts;
-        verts.reserve(segments + 2);
-
-        // Center vertex
-        verts.push_back({ {cx, cy}, fcol, {0,0} });
-
-        // Arc points
-        for (int i = 0; i <= segments; ++i) {
-            float ang = (startDeg + (90.0f * i / segments)) * (float(M_PI)/180.0f);
-            verts.push_back({
-                { cx + radius * std::cos(ang),
-                  cy + radius * std::sin(ang) },
-                fcol,
-                {0,0}
-            });
-        }
-
-        // Build indices for the fan
-        std::vector<int> idx;
-        idx.reserve(segments * 3);
-        for (int i = 1; i <= segments; ++i) {
-            idx.push_back(0);
-            idx.push_back(i);
-            idx.push_back(i+1);
-        }
-
-        // Draw
-        SDL_RenderGeometry(Sys::renderer,
-                           /*texture=*/ nullptr,
-                           verts.data(), (int)verts.size(),
-                           idx.data(),   (int)idx.size());
-    };
-
-    // 3) Draw four corners
-    drawCorner(rect.x + radius,               rect.y + radius,               180.0f); // TL
-    drawCorner(rect.x + rect.w - radius,     rect.y + radius,               270.0f); // TR
-    drawCorner(rect.x + rect.w - radius,     rect.y + rect.h - radius,       0.0f); // BR
-    drawCorner(rect.x + radius,               rect.y + rect.h - radius,      90.0f); // BL
-}
-
-
-
-
-
-
-// A helper function that always produces (segments+1) vertices per corner,
-// even if the radius is 0 (in which case it outputs duplicate vertices).
-std::vector<SDL_Vertex> computeRoundedRectPolygonFixed(
-    const SDL_Rect& rect,
-    const BorderRadiusRect& br,
-    const SDL_Color& color,
-    int segments = 8)
-{
-    std::vector<SDL_Vertex> vertices;
-    vertices.reserve((segments+1)*4);
-
-    auto pushV = [&](float x, float y){
-        SDL_Vertex v;
-        v.position  = {x,y};
-        v.color     = TO_FCOLOR(color);
-        v.tex_coord = {0,0};
-        vertices.push_back(v);
-    };
-
-    auto makeArc = [&](float cx, float cy, float startA, float endA, unsigned r){
-        std::vector<SDL_FPoint> pts;
-        pts.reserve(segments+1);
-        for (int i=0; i<=segments; ++i){
-            float t = float(i)/segments;
-            float a = (startA + t*(endA-startA)) * (M_PI/180.f);
-            pts.push_back({ cx + r*cos(a), cy + r*sin(a) });
-        }
-        return pts;
-    };
-
-    // Build each of the four corner arcs
-    auto arcTL = makeArc(rect.x + br.top_left,     rect.y + br.top_left,     180, 270, br.top_left);
-    auto arcTR = makeArc(rect.x + rect.w - br.top_right, rect.y + br.top_right,    270, 360, br.top_right);
-    auto arcBR = makeArc(rect.x + rect.w - br.bottom_right, rect.y + rect.h - br.bottom_right, 0, 90,  br.bottom_right);
-    auto arcBL = makeArc(rect.x + br.bottom_left,  rect.y + rect.h - br.bottom_left,  90, 180, br.bottom_left);
-
-    // 1) Push *all* of arcTL
-    for (auto &p : arcTL) pushV(p.x, p.y);
-    // 2) Push arcTR *except* its first point (already at end of arcTL)
-    for (int i=1; i<(int)arcTR.size(); ++i) pushV(arcTR[i].x, arcTR[i].y);
-    // 3) arcBR, skip its first
-    for (int i=1; i<(int)arcBR.size(); ++i) pushV(arcBR[i].x, arcBR[i].y);
-    // 4) arcBL, skip its first
-    for (int i=1; i<(int)arcBL.size(); ++i) pushV(arcBL[i].x, arcBL[i].y);
-
-    return vertices;
-}
-
-
-
 // Helper: Linear interpolation along a polyline.
 // poly: vector of SDL_FPoint representing a closed polyline.
 // cumLengths: cumulative distances along poly (same size as poly).
@@ -246,75 +94,29 @@ void drawDashedLineRect(
 
 
 
-void drawRoundedOutlineRect(
-    const SDL_Rect& dRect,
-    const int thickness,
-    const BorderRadiusRect& borderRadius,
-    const SDL_Color& color, 
-    const int arcSegments
-){
-    // Outer polygon (using full radii).
-    std::vector<SDL_Vertex> outerVerts = computeRoundedRectPolygonFixed(dRect, borderRadius, color, arcSegments);
-
-    // Define inner rect inset by thickness.
-    SDL_Rect innerRect = { dRect.x + thickness, dRect.y + thickness,
-                           dRect.w - 2 * thickness, dRect.h - 2 * thickness };
-
-    // For inner radii, subtract thickness but clamp at 0.
-    BorderRadiusRect innerBR;
-    innerBR.top_left     = (borderRadius.top_left     > (unsigned)thickness) ? borderRadius.top_left     - thickness : 0;
-    innerBR.top_right    = (borderRadius.top_right    > (unsigned)thickness) ? borderRadius.top_right    - thickness : 0;
-    innerBR.bottom_right = (borderRadius.bottom_right > (unsigned)thickness) ? borderRadius.bottom_right - thickness : 0;
-    innerBR.bottom_left  = (borderRadius.bottom_left  > (unsigned)thickness) ? borderRadius.bottom_left  - thickness : 0;
-
-    // Using our fixed polygon generator ensures that even when a radius becomes 0,
-    // the inner polygon has the same vertex count as the outer polygon.
-    std::vector<SDL_Vertex> innerVerts = computeRoundedRectPolygonFixed(innerRect, innerBR, color, arcSegments);
-
-    // Stitch the outer and inner polygons together.
-    size_t n = outerVerts.size();
-    std::vector<SDL_Vertex> borderVerts;
-    std::vector<int> indices;
-    for (size_t i = 0; i < n; i++) {
-        size_t next = (i + 1) % n;
-        int base = static_cast<int>(borderVerts.size());
-        borderVerts.push_back(outerVerts[i]);
-        borderVerts.push_back(outerVerts[next]);
-        borderVerts.push_back(innerVerts[next]);
-        borderVerts.push_back(innerVerts[i]);
-
-        // Two triangles per quad.
-        indices.push_back(base + 0);
-        indices.push_back(base + 1);
-        indices.push_back(base + 2);
-
-        indices.push_back(base + 0);
-        indices.push_back(base + 2);
-        indices.push_back(base + 3);
-    }
-
-    SDL_RenderGeometry(
-        Sys::renderer, 
-        nullptr,
-        borderVerts.data(), 
-        static_cast<int>(borderVerts.size()),
-        indices.data(), 
-        static_cast<int>(indices.size())
-    );
-}
-
-
-
+// Points of a corner arc, startAngle has to be a multiple of 90.
+// The unit arc comes from the ShapeCache, so no cos/sin is computed here.
 std::vector<SDL_FPoint> computeCornerArc(
     float cx, float cy, 
     float startAngle, float endAngle, 
     unsigned int r, int segments = 8
 ) {
+    const std::vector<SDL_FPoint>& arc = ShapeCache::quarterArc(segments);
+    int quadrant = (static_cast<int>(startAngle) / 90) % 4;
+    (void)endAngle; // Always startAngle + 90
+
     std::vector<SDL_FPoint> pts;
-    for (int i = 0; i <= segments; i++) {
-        float t = static_cast<float>(i) / segments;
-        float angle = (startAngle + t * (endAngle - startAngle)) * (M_PI / 180.f);
-        pts.push_back({ cx + r * cos(angle), cy + r * sin(angle) });
+    pts.reserve(arc.size());
+    for (size_t i = 0; i < arc.size(); i++) {
+        SDL_FPoint p = arc[i];
+        SDL_FPoint d;
+        switch (quadrant) {
+            case 0:  d = {  p.x,  p.y }; break;
+            case 1:  d = { -p.y,  p.x }; break;
+            case 2:  d = { -p.x, -p.y }; break;
+            default: d = {  p.y, -p.x }; break;
+        }
+        pts.push_back({ cx + r * d.x, cy + r * d.y });
     }
     return pts;
 }
@@ -428,7 +230,12 @@ void GUI::renderRect(
     // ----------------------------------------------------------------------------------------
     // UNDASHED RECT ----------------------------------------------------------------------------   
     
-    int arcSegments = 8;
+    // Enough segments for the biggest corner to look smooth
+    uint maxRadius = std::max(
+        std::max(borderRadius.top_left, borderRadius.top_right),
+        std::max(borderRadius.bottom_left, borderRadius.bottom_right)
+    );
+    int arcSegments = ShapeCache::arcSegments(float(maxRadius), 90.0f);
 
     // Options: 
     // RectFill    Corners      Style
@@ -456,14 +263,14 @@ void GUI::renderRect(
 
     if(thickness == -1){
         SDL_FRect fRect = TO_FRECT(dRect);
-        if(noRounded) {
+        if(noRounded && !ShapeAtlas::isEnabled()) {
             // FILLED [NOT ROUNDED] RECT
-            SDL_SetRenderDrawColor(Sys::renderer, color);
-            SDL_RenderFillRect(Sys::renderer, &fRect);
+            // (with the ShapeAtlas on, this goes trough it too so it batches with the rest)
+            DrawList::fillRect(fRect, color);
         }
         else{
             // FULL [ROUNDED] RECT
-            drawRoundedFilledRect(dRect, borderRadius.top_left, color);
+            ShapeCache::roundedRect(dRect, borderRadius, -1, color);
         }
 
         return;
@@ -479,7 +286,7 @@ void GUI::renderRect(
 
     if(!pDashLine) {
         // The function will detect if the borderRadius is 0, so it wont round the corners
-        drawRoundedOutlineRect(dRect, thickness, borderRadius, color, arcSegments);
+        ShapeCache::roundedRect(dRect, borderRadius, thickness, color);
 
         return;
     }
@@ -520,7 +327,7 @@ void GUI::renderRect(
             static_cast<float>(fillerSize), 
             static_cast<float>(fillerSize) 
         };
-        SDL_RenderFillRect(Sys::renderer, &cornerRect);
+        DrawList::fillRect(cornerRect, color);
 
         // Top-right corner filler.
         cornerRect = { 
@@ -529,7 +336,7 @@ void GUI::renderRect(
             static_cast<float>(fillerSize), 
             static_cast<float>(fillerSize) 
         };
-        SDL_RenderFillRect(Sys::renderer, &cornerRect);
+        DrawList::fillRect(cornerRect, color);
 
         // Bottom-right corner filler.
         cornerRect = { 
@@ -538,7 +345,7 @@ void GUI::renderRect(
             static_cast<float>(fillerSize), 
             static_cast<float>(fillerSize) 
         };
-        SDL_RenderFillRect(Sys::renderer, &cornerRect);
+        DrawList::fillRect(cornerRect, color);
 
         // Bottom-left corner filler.
         cornerRect = { 
@@ -547,7 +354,7 @@ void GUI::renderRect(
             static_cast<float>(fillerSize), 
             static_cast<float>(fillerSize) 
         };
-        SDL_RenderFillRect(Sys::renderer, &cornerRect);
+        DrawList::fillRect(cornerRect, color);
         return;
     }
 
@@ -602,6 +409,7 @@ void GUI::Rect(
     const SDL_Color& color, 
     const int thickness
 ) {
+    PROFILE_ZONE("GUI::Rect");
     if(dRect.w < 1 && dRect.h < 1){
         cout << "Invalid Rect size" << endl;
         return;
@@ -638,45 +446,157 @@ void GUI::Rect(
     
     // ---------------------------------------------------------------------------------------
 
-    TextureData canvas;
-    SDL_Texture* tex = SDL_CreateTexture(
-        Sys::renderer,
-        SDL_PIXELFORMAT_RGBA32,
-        SDL_TEXTUREACCESS_TARGET,
-        dRect.w,
-        dRect.h
-    );
-    if(tex == nullptr) {
-        Sys::printf_err(TM_TEXTURE_CREATE_ERROR);
-        SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "SDL_CreateTexture error: %s\n", SDL_GetError());
+    // The rect is drawn directly onto the current render target, so if
+    // there is an active container its position has to be converted into
+    // absolute coordinates and everything outside of the container clipped
+    SDL_Rect absRect = dRect;
+
+    bool clipSet = false;
+    SDL_Rect clipRect = {0, 0, 0, 0};
+
+    if(!activeContainer.empty()){
+        auto container = getContainerState(activeContainer);
+        container->contentHeight = std::max(dRect.y + dRect.h, container->contentHeight);
+
+        absRect.x += container->dRect.x;
+        absRect.y += container->dRect.y - container->scrollOffset;
+
+        clipRect = container->dRect;
+        clipSet = true;
+    }
+
+    // Dashed outlines are drawn as separate segments, centered on the
+    // edges of the rect, so they are clipped to the rect itself
+    bool dashed = (thickness != -1 && pDashLine);
+
+    // Translucent dashed outlines can't be drawn directly as their
+    // segments overlap, render them trough the baked shapes cache
+    if(dashed && color.a < 255){
+        renderBakedRect(absRect, color, thickness, borderRadius, clipSet ? &clipRect : nullptr);
         return;
     }
 
-    // in GUI::Rect, after creating 'tex':
-    SDL_SetTextureScaleMode(tex, SDL_SCALEMODE_LINEAR);
-    SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_BLEND);
+    if(dashed){
+        SDL_Rect dashClip = absRect;
+        if(clipSet && !SDL_GetRectIntersection(&clipRect, &absRect, &dashClip)) {
+            pDashLine = false;
+            return;
+        }
+        clipRect = dashClip;
+        clipSet = true;
+    }
 
-    canvas.setTexture(tex);
-    canvas.reloadInfo();
+    if(clipSet) DrawList::setClipRect(&clipRect);
+    renderRect(absRect, color, thickness, borderRadius);
+    if(clipSet) DrawList::setClipRect(nullptr);
 
-    SDL_Rect mutable_dRect = dRect;
-    mutable_dRect.x = 0;
-    mutable_dRect.y = 0;
+    return;
+}
 
-    auto oldRenderTarget = SDL_GetRenderTarget(Sys::renderer);
-    SDL_SetRenderTarget(Sys::renderer, canvas.getTexture());
-    
-    SDL_SetRenderDrawColor(Sys::renderer, 0, 0, 0, 0);
-    SDL_RenderClear(Sys::renderer);
-    renderRect(mutable_dRect, color, thickness, borderRadius);
-    
-    SDL_SetRenderTarget(Sys::renderer, oldRenderTarget);
 
-    mutable_dRect = dRect;
-    GUI::Image(canvas, mutable_dRect);
 
-    SDL_DestroyTexture(canvas.getTexture());
-    canvas.setTexture(nullptr);
 
-    return;
-}
\ No newline at end of file
+void GUI::renderBakedRect(
+    const SDL_Rect& dRect,
+    const SDL_Color& color,
+    const int thickness,
+    const BorderRadiusRect& borderRadius,
+    const SDL_Rect* clipRect
+){
+    BakedShapeKey key = {
+        dRect.w,
+        dRect.h,
+        thickness,
+        borderRadius,
+        pDashSize,
+        pDashGapSize
+    };
+
+    BakedShape* shape = nullptr;
+
+    auto it = bakedShapes.find(key);
+    if(it != bakedShapes.end()){
+        shape = &it->second;
+
+        // renderRect is not called, so reset the pushed style here
+        pDashLine = false;
+
+        // Move it to the front of the LRU list
+        if(shape != bakedFront){
+            shape->lruPrev->lruNext = shape->lruNext;
+            if(shape->lruNext) shape->lruNext->lruPrev = shape->lruPrev;
+            else bakedBack = shape->lruPrev;
+
+            shape->lruPrev = nullptr;
+            shape->lruNext = bakedFront;
+            bakedFront->lruPrev = shape;
+            bakedFront = shape;
+        }
+    } else {
+        // If there are more shapes then allowed remove the least recently used
+        if((int)bakedShapes.size() >= MAX_BAKED_SHAPES && bakedBack != nullptr){
+            BakedShape* oldest = bakedBack;
+            bakedBack = oldest->lruPrev;
+            if(bakedBack) bakedBack->lruNext = nullptr;
+            else bakedFront = nullptr;
+
+            bakedShapes.erase(oldest->key);
+        }
+
+        SDL_Texture* tex = TM::acquireTexture(
+            SDL_PIXELFORMAT_RGBA32,
+            SDL_TEXTUREACCESS_TARGET,
+            dRect.w,
+            dRect.h
+        );
+        if(tex == nullptr) {
+            Sys::printf_err(TM_TEXTURE_CREATE_ERROR);
+            SDL_LogError(SDL_LOG_CATEGORY_VIDEO, "SDL_CreateTexture error: %s\n", SDL_GetError());
+            pDashLine = false;
+            return;
+        }
+
+        // Opaque white blended onto transparent black comes out premultiplied
+        SDL_BlendMode premultiplied = SDL_ComposeCustomBlendMode(
+            SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD,
+            SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD
+        );
+        SDL_SetTextureScaleMode(tex, SDL_SCALEMODE_LINEAR);
+        SDL_SetTextureBlendMode(tex, premultiplied);
+
+        shape = &bakedShapes.insert({key, BakedShape{TextureData(), key, nullptr, bakedFront}}).first->second;
+        shape->td.setTexture(tex);
+        shape->td.id = "BAKED-RECT";
+
+        if(bakedFront) bakedFront->lruPrev = shape;
+        bakedFront = shape;
+        if(bakedBack == nullptr) bakedBack = shape;
+
+        // Render the shape into the texture, at (0, 0). Opaque, so
+        // the overlapping segments don't add up
+        SDL_Rect canvasRect = {0, 0, dRect.w, dRect.h};
+
+        auto oldRenderTarget = SDL_GetRenderTarget(Sys::renderer);
+        TM::setRenderTarget(tex);
+
+        SDL_SetRenderDrawColor(Sys::renderer, 0, 0, 0, 0);
+        SDL_RenderClear(Sys::renderer);
+        Sys::counters.clearCalls++;
+        renderRect(canvasRect, SDL_COLOR_WHITE, thickness, borderRadius);
+
+        TM::setRenderTarget(oldRenderTarget);
+    }
+
+    // The texture is premultiplied, so is the tint
+    SDL_Color tint = {
+        Uint8(color.r * color.a / 255),
+        Uint8(color.g * color.a / 255),
+        Uint8(color.b * color.a / 255),
+        color.a
+    };
+
+    SDL_FRect fRect = TO_FRECT(dRect);
+    if(clipRect) DrawList::setClipRect(clipRect);
+    DrawList::texture(shape->td.getTexture(), nullptr, fRect, tint);
+    if(clipRect) DrawList::setClipRect(nullptr);
+}
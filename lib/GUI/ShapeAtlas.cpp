@@ -0,0 +1,276 @@
+#include "gui.h"
+#include "../System/Sys.h"
+
+
+
+// Signed distance from p to a box centered at (0,0) with half size (bx, by)
+// and a radius per corner (TL, TR, BR, BL). Negative inside. y points down.
+static float roundedBoxDistance(float px, float py, float bx, float by, const float r[4]){
+    float radius;
+    if(px < 0) radius = (py < 0) ? r[0] : r[3];
+    else       radius = (py < 0) ? r[1] : r[2];
+
+    float qx = std::abs(px) - bx + radius;
+    float qy = std::abs(py) - by + radius;
+
+    float outside = std::sqrt(std::max(qx, 0.0f)*std::max(qx, 0.0f) + std::max(qy, 0.0f)*std::max(qy, 0.0f));
+    float inside = std::min(std::max(qx, qy), 0.0f);
+
+    return outside + inside - radius;
+}
+
+// 1px wide anti-aliased edge
+static Uint8 coverage(float distance){
+    float c = std::clamp(0.5f - distance, 0.0f, 1.0f);
+    return static_cast<Uint8>(c * 255.0f + 0.5f);
+}
+
+
+
+void ShapeAtlas::setEnabled(bool value){ enabled = value; }
+bool ShapeAtlas::isEnabled(){ return enabled; }
+
+
+
+void ShapeAtlas::reset(){
+    cells.clear();
+    shelfX = 0;
+    shelfY = 0;
+    shelfHeight = 0;
+
+    // Pending commands might still be sampling the old cells, so insted
+    // of overwriting them a new texture is made, the old one is
+    // destroyed once they are drawn
+    if(atlas != nullptr){
+        TM::destroyTexture(atlas);
+        atlas = nullptr;
+    }
+}
+
+
+
+void ShapeAtlas::clear(){ reset(); }
+
+
+
+bool ShapeAtlas::allocate(int w, int h, SDL_Rect& out){
+    // 1px gap between the cells
+    int pw = w + 1;
+    int ph = h + 1;
+    if(pw > ATLAS_SIZE || ph > ATLAS_SIZE) return false;
+
+    // Move to the next shelf if this one is full
+    if(shelfX + pw > ATLAS_SIZE){
+        shelfY += shelfHeight;
+        shelfX = 0;
+        shelfHeight = 0;
+    }
+
+    if(shelfY + ph > ATLAS_SIZE) return false;
+
+    out = { shelfX, shelfY, w, h };
+    shelfX += pw;
+    shelfHeight = std::max(shelfHeight, ph);
+    return true;
+}
+
+
+
+const ShapeAtlas::Cell* ShapeAtlas::getCell(const CellKey& key){
+    auto it = cells.find(key);
+    if(it != cells.end()) return &it->second;
+
+    // CELL LAYOUT -----------------------------------------------------------
+    Cell cell = {};
+    int w, h;
+
+    if(key.kind == CellKind::CIRCLE){
+        w = h = key.radius[0] * 2;
+    } else {
+        // Nine-slice borders must hold the corners and the outline
+        int t = std::max(key.thickness, 0);
+        cell.left   = std::max<int>({ (int)key.radius[0], (int)key.radius[3], t });
+        cell.right  = std::max<int>({ (int)key.radius[1], (int)key.radius[2], t });
+        cell.top    = std::max<int>({ (int)key.radius[0], (int)key.radius[1], t });
+        cell.bottom = std::max<int>({ (int)key.radius[3], (int)key.radius[2], t });
+
+        // A single row/column in the middle which gets stretched
+        w = cell.left + 1 + cell.right;
+        h = cell.top + 1 + cell.bottom;
+    }
+
+    if(!allocate(w, h, cell.rect)){
+        // Atlas is full, start over
+        reset();
+        if(!allocate(w, h, cell.rect)) return nullptr;
+    }
+
+    // CREATE THE ATLAS ON FIRST USE (OR AFTER A RESET) ----------------------
+    if(atlas == nullptr){
+        atlas = TM::createTexture(
+            SDL_PIXELFORMAT_RGBA32,
+            SDL_TEXTUREACCESS_STATIC,
+            ATLAS_SIZE, ATLAS_SIZE
+        );
+        if(atlas == nullptr) return nullptr;
+
+        SDL_SetTextureBlendMode(atlas, SDL_BLENDMODE_BLEND);
+
+        // Corners are copied 1:1 and edges are stretched from a single
+        // row/column, so linear filtering would only bleed the neighbours in
+        SDL_SetTextureScaleMode(atlas, SDL_SCALEMODE_NEAREST);
+    }
+
+    // RASTERIZE THE COVERAGE ------------------------------------------------
+    // White pixels, the shape is in the alpha, color comes from the vertices
+    vector<Uint32> pixels(w * h);
+    Uint8* bytes = reinterpret_cast<Uint8*>(pixels.data());
+
+    for(int y = 0; y < h; y++){
+        for(int x = 0; x < w; x++){
+            // Pixel center, relative to the center of the cell
+            float px = x + 0.5f - w / 2.0f;
+            float py = y + 0.5f - h / 2.0f;
+            float d;
+
+            if(key.kind == CellKind::CIRCLE){
+                float r = float(key.radius[0]);
+                float len = std::sqrt(px*px + py*py);
+                d = len - r;
+                if(key.thickness != -1) d = std::max(d, (r - key.thickness) - len);
+            } else {
+                float r[4] = {
+                    float(key.radius[0]), float(key.radius[1]),
+                    float(key.radius[2]), float(key.radius[3])
+                };
+                d = roundedBoxDistance(px, py, w / 2.0f, h / 2.0f, r);
+
+                if(key.thickness != -1){
+                    float t = float(key.thickness);
+                    float ri[4];
+                    for(int c = 0; c < 4; c++) ri[c] = std::max(0.0f, r[c] - t);
+
+                    // Inner box is centered too, as the outline is the same on every side
+                    float inner = roundedBoxDistance(px, py, w / 2.0f - t, h / 2.0f - t, ri);
+                    d = std::max(d, -inner);
+                }
+            }
+
+            Uint8* p = bytes + (y * w + x) * 4;
+            p[0] = 255; p[1] = 255; p[2] = 255;
+            p[3] = coverage(d);
+        }
+    }
+
+    if(!TM::updateTexture(atlas, &cell.rect, pixels.data(), w * 4)) return nullptr;
+
+    return &cells.emplace(key, cell).first->second;
+}
+
+
+
+bool ShapeAtlas::circle(
+    const SDL_FPoint& center,
+    float radius,
+    int thickness,
+    const SDL_Color& color
+) {
+    if(!enabled) return false;
+
+    // Cells are made per whole pixel radius
+    int r = static_cast<int>(std::lround(radius));
+    if(r < 1 || r > MAX_RADIUS || std::abs(radius - r) > 0.01f) return false;
+
+    CellKey key = {};
+    key.kind = CellKind::CIRCLE;
+    key.radius[0] = r;
+    key.thickness = (thickness == -1 || thickness >= r) ? -1 : thickness;
+
+    const Cell* cell = getCell(key);
+    if(cell == nullptr) return false;
+
+    SDL_FRect src = TO_FRECT(cell->rect);
+    SDL_FRect dst = { center.x - r, center.y - r, float(2*r), float(2*r) };
+
+    float inv = 1.0f / ATLAS_SIZE;
+    SDL_FColor fcol = TO_FCOLOR(color);
+
+    SDL_Vertex quad[4] = {
+        { { dst.x,         dst.y },         fcol, { src.x * inv,           src.y * inv } },
+        { { dst.x + dst.w, dst.y },         fcol, { (src.x + src.w) * inv, src.y * inv } },
+        { { dst.x + dst.w, dst.y + dst.h }, fcol, { (src.x + src.w) * inv, (src.y + src.h) * inv } },
+        { { dst.x,         dst.y + dst.h }, fcol, { src.x * inv,           (src.y + src.h) * inv } }
+    };
+    const int quadIndices[6] = { 0, 1, 2, 0, 2, 3 };
+
+    DrawList::geometry(atlas, quad, 4, quadIndices, 6);
+    return true;
+}
+
+
+
+bool ShapeAtlas::roundedRect(
+    const SDL_Rect& rect,
+    const BorderRadiusRect& radius,
+    int thickness,
+    const SDL_Color& color
+) {
+    if(!enabled) return false;
+
+    uint maxRadius = std::max(
+        std::max(radius.top_left, radius.top_right),
+        std::max(radius.bottom_right, radius.bottom_left)
+    );
+    if((int)maxRadius > MAX_RADIUS || thickness > MAX_RADIUS) return false;
+
+    CellKey key = {};
+    key.kind = CellKind::RECT;
+    key.radius[0] = radius.top_left;
+    key.radius[1] = radius.top_right;
+    key.radius[2] = radius.bottom_right;
+    key.radius[3] = radius.bottom_left;
+    key.thickness = thickness;
+
+    const Cell* cell = getCell(key);
+    if(cell == nullptr) return false;
+
+    // The corners are never scaled, so the rect has to be big enough for them
+    if(rect.w < cell->left + cell->right || rect.h < cell->top + cell->bottom) return false;
+
+    // NINE-SLICE ------------------------------------------------------------
+    // Column and row edges, in the atlas and on the screen
+    const SDL_Rect& c = cell->rect;
+    float sx[4] = { float(c.x), float(c.x + cell->left), float(c.x + cell->left + 1), float(c.x + c.w) };
+    float sy[4] = { float(c.y), float(c.y + cell->top),  float(c.y + cell->top + 1),  float(c.y + c.h) };
+
+    float dx[4] = { float(rect.x), float(rect.x + cell->left), float(rect.x + rect.w - cell->right),  float(rect.x + rect.w) };
+    float dy[4] = { float(rect.y), float(rect.y + cell->top),  float(rect.y + rect.h - cell->bottom), float(rect.y + rect.h) };
+
+    float inv = 1.0f / ATLAS_SIZE;
+    SDL_FColor fcol = TO_FCOLOR(color);
+
+    SDL_Vertex verts[9 * 4];
+    int idx[9 * 6];
+    int nv = 0, ni = 0;
+
+    for(int row = 0; row < 3; row++){
+        for(int col = 0; col < 3; col++){
+            // Empty slices (zero borders) are skipped and so is the
+            // center of an outline, its always transparent
+            if(dx[col] >= dx[col+1] || dy[row] >= dy[row+1]) continue;
+            if(row == 1 && col == 1 && thickness != -1) continue;
+
+            verts[nv + 0] = { { dx[col],   dy[row]   }, fcol, { sx[col] * inv,   sy[row] * inv } };
+            verts[nv + 1] = { { dx[col+1], dy[row]   }, fcol, { sx[col+1] * inv, sy[row] * inv } };
+            verts[nv + 2] = { { dx[col+1], dy[row+1] }, fcol, { sx[col+1] * inv, sy[row+1] * inv } };
+            verts[nv + 3] = { { dx[col],   dy[row+1] }, fcol, { sx[col] * inv,   sy[row+1] * inv } };
+
+            idx[ni++] = nv + 0; idx[ni++] = nv + 1; idx[ni++] = nv + 2;
+            idx[ni++] = nv + 0; idx[ni++] = nv + 2; idx[ni++] = nv + 3;
+            nv += 4;
+        }
+    }
+
+    if(nv > 0) DrawList::geometry(atlas, verts, nv, idx, ni);
+    return true;
+}
@@ -0,0 +1,296 @@
+#include "gui.h"
+#include "../System/Sys.h"
+
+
+
+int ShapeCache::arcSegments(float radius, float degrees){
+    if(radius <= MAX_ERROR || degrees <= 0) return 1;
+
+    // A chord spanning the angle a deviates from the arc by r*(1 - cos(a/2)),
+    // so the biggest angle that stays within MAX_ERROR is 2*acos(1 - MAX_ERROR/r)
+    float maxStep = 2.0f * std::acos(1.0f - MAX_ERROR / radius);
+    int segments = static_cast<int>(std::ceil(degrees * (float(M_PI)/180.0f) / maxStep));
+
+    int maxSegments = static_cast<int>(std::ceil(degrees / 360.0f * 1024));
+    return std::clamp(segments, 1, std::max(1, maxSegments));
+}
+
+
+
+const vector<SDL_FPoint>& ShapeCache::quarterArc(int segments){
+    segments = std::max(1, segments);
+
+    auto it = quarterArcs.find(segments);
+    if(it != quarterArcs.end()) return it->second;
+
+    vector<SDL_FPoint> pts;
+    pts.reserve(segments + 1);
+    for(int i = 0; i <= segments; i++){
+        float a = (90.0f * i / segments) * (float(M_PI)/180.0f);
+        pts.push_back({ std::cos(a), std::sin(a) });
+    }
+
+    // Make the ends exact, so the straight edges line up
+    pts.front() = {1.0f, 0.0f};
+    pts.back()  = {0.0f, 1.0f};
+
+    return quarterArcs.emplace(segments, std::move(pts)).first->second;
+}
+
+
+
+const ShapeCache::CircleMesh& ShapeCache::getCircleMesh(int segments){
+    auto it = circleMeshes.find(segments);
+    if(it != circleMeshes.end()) return it->second;
+
+    CircleMesh mesh;
+
+    // The circle is built from four rotated quarter arcs
+    const vector<SDL_FPoint>& arc = quarterArc(segments / 4);
+    int q = segments / 4;
+    mesh.points.reserve(segments);
+    for(int quadrant = 0; quadrant < 4; quadrant++){
+        for(int i = 0; i < q; i++){
+            SDL_FPoint p = arc[i];
+            switch(quadrant){
+                case 0: mesh.points.push_back({  p.x,  p.y }); break;
+                case 1: mesh.points.push_back({ -p.y,  p.x }); break;
+                case 2: mesh.points.push_back({ -p.x, -p.y }); break;
+                case 3: mesh.points.push_back({  p.y, -p.x }); break;
+            }
+        }
+    }
+
+    // FILLED: fan around the center, which is vertex [segments]
+    mesh.fillIndices.reserve(segments * 3);
+    for(int i = 0; i < segments; i++){
+        mesh.fillIndices.push_back(segments);
+        mesh.fillIndices.push_back(i);
+        mesh.fillIndices.push_back((i + 1) % segments);
+    }
+
+    // RING: outer points are [0, segments), inner ones [segments, 2*segments)
+    mesh.ringIndices.reserve(segments * 6);
+    for(int i = 0; i < segments; i++){
+        int next = (i + 1) % segments;
+
+        mesh.ringIndices.push_back(i);
+        mesh.ringIndices.push_back(next);
+        mesh.ringIndices.push_back(segments + next);
+
+        mesh.ringIndices.push_back(i);
+        mesh.ringIndices.push_back(segments + next);
+        mesh.ringIndices.push_back(segments + i);
+    }
+
+    return circleMeshes.emplace(segments, std::move(mesh)).first->second;
+}
+
+
+
+void ShapeCache::circle(
+    const SDL_FPoint& center,
+    float radius,
+    int thickness,
+    const SDL_Color& color
+) {
+    if(radius <= 0) return;
+    if(ShapeAtlas::isEnabled() && ShapeAtlas::circle(center, radius, thickness, color)) return;
+
+    // Multiple of 4, so the circle can be built from quarter arcs
+    int segments = arcSegments(radius, 360.0f);
+    segments = std::max(8, (segments + 3) / 4 * 4);
+
+    const CircleMesh& mesh = getCircleMesh(segments);
+    SDL_FColor fcol = TO_FCOLOR(color);
+
+    if(thickness == -1){
+        scratch.resize(segments + 1);
+        for(int i = 0; i < segments; i++){
+            scratch[i] = {
+                { center.x + radius * mesh.points[i].x, center.y + radius * mesh.points[i].y },
+                fcol,
+                {0, 0}
+            };
+        }
+        scratch[segments] = { center, fcol, {0, 0} };
+
+        DrawList::geometry(
+            nullptr,
+            scratch.data(), static_cast<int>(scratch.size()),
+            mesh.fillIndices.data(), static_cast<int>(mesh.fillIndices.size())
+        );
+        return;
+    }
+
+    // Clamp thickness to be at most the radius
+    float inner = radius - std::min<float>(thickness, radius);
+
+    scratch.resize(segments * 2);
+    for(int i = 0; i < segments; i++){
+        const SDL_FPoint& p = mesh.points[i];
+        scratch[i]            = { { center.x + radius * p.x, center.y + radius * p.y }, fcol, {0, 0} };
+        scratch[segments + i] = { { center.x + inner  * p.x, center.y + inner  * p.y }, fcol, {0, 0} };
+    }
+
+    DrawList::geometry(
+        nullptr,
+        scratch.data(), static_cast<int>(scratch.size()),
+        mesh.ringIndices.data(), static_cast<int>(mesh.ringIndices.size())
+    );
+}
+
+
+
+const ShapeCache::Mesh& ShapeCache::getRectMesh(const RectMeshKey& key){
+    auto it = rectMeshes.find(key);
+    if(it != rectMeshes.end()){
+        it->second.lastUsedFrame = Sys::getCurrentFrame();
+        return it->second;
+    }
+
+    // Remove the least recently used mesh if the map is full
+    if(MAX_MESHES > 0 && (int)rectMeshes.size() >= MAX_MESHES){
+        auto oldest = rectMeshes.begin();
+        for(auto i = rectMeshes.begin(); i != rectMeshes.end(); i++){
+            if(i->second.lastUsedFrame < oldest->second.lastUsedFrame) oldest = i;
+        }
+        rectMeshes.erase(oldest);
+    }
+
+    Mesh mesh;
+    mesh.lastUsedFrame = Sys::getCurrentFrame();
+
+    const vector<SDL_FPoint>& arc = quarterArc(key.segments);
+
+    // Sign of the direction from each corner towards the inside
+    // of the rect, in TL, TR, BR, BL order
+    const float inX[4] = {  1, -1, -1,  1 };
+    const float inY[4] = {  1,  1, -1, -1 };
+
+    // Adds one polygon (segments+1 points per corner), inset by `inset`
+    // px from the rect, with corner radii `r`
+    auto addPolygon = [&](float inset, const float r[4]){
+        for(Uint8 c = 0; c < 4; c++){
+            // Center of the corner arc, relative to the rect corner
+            float cx = inX[c] * (inset + r[c]);
+            float cy = inY[c] * (inset + r[c]);
+
+            for(int i = 0; i <= key.segments; i++){
+                // Rotate the 0-90 arc into this corners quadrant, going clockwise
+                SDL_FPoint p = arc[i];
+                SDL_FPoint d;
+                switch(c){
+                    case 0:  d = { -p.x, -p.y }; break;     // 180 - 270
+                    case 1:  d = {  p.y, -p.x }; break;     // 270 - 360
+                    case 2:  d = {  p.x,  p.y }; break;     // 0 - 90
+                    default: d = { -p.y,  p.x }; break;     // 90 - 180
+                }
+
+                mesh.points.push_back({ cx + r[c] * d.x, cy + r[c] * d.y });
+                mesh.corners.push_back(c);
+            }
+        }
+    };
+
+    float outerR[4] = {
+        float(key.radius[0]), float(key.radius[1]),
+        float(key.radius[2]), float(key.radius[3])
+    };
+    addPolygon(0, outerR);
+
+    int n = static_cast<int>(mesh.points.size());
+
+    if(key.thickness == -1){
+        // FILLED: the polygon is convex, so a fan from the first point covers it
+        mesh.indices.reserve((n - 2) * 3);
+        for(int i = 1; i < n - 1; i++){
+            mesh.indices.push_back(0);
+            mesh.indices.push_back(i);
+            mesh.indices.push_back(i + 1);
+        }
+    } else {
+        // OUTLINE: inner polygon has the same amount of points, even if
+        // its radii become 0, so the two can be stitched together
+        float t = float(key.thickness);
+        float innerR[4];
+        for(int c = 0; c < 4; c++) innerR[c] = std::max(0.0f, outerR[c] - t);
+        addPolygon(t, innerR);
+
+        mesh.indices.reserve(n * 6);
+        for(int i = 0; i < n; i++){
+            int next = (i + 1) % n;
+
+            mesh.indices.push_back(i);
+            mesh.indices.push_back(next);
+            mesh.indices.push_back(n + next);
+
+            mesh.indices.push_back(i);
+            mesh.indices.push_back(n + next);
+            mesh.indices.push_back(n + i);
+        }
+    }
+
+    return rectMeshes.emplace(key, std::move(mesh)).first->second;
+}
+
+
+
+void ShapeCache::roundedRect(
+    const SDL_Rect& rect,
+    const BorderRadiusRect& radius,
+    int thickness,
+    const SDL_Color& color
+) {
+    if(ShapeAtlas::isEnabled() && ShapeAtlas::roundedRect(rect, radius, thickness, color)) return;
+
+    uint maxRadius = std::max(
+        std::max(radius.top_left, radius.top_right),
+        std::max(radius.bottom_right, radius.bottom_left)
+    );
+
+    RectMeshKey key;
+    key.radius[0] = radius.top_left;
+    key.radius[1] = radius.top_right;
+    key.radius[2] = radius.bottom_right;
+    key.radius[3] = radius.bottom_left;
+    key.thickness = thickness;
+    key.segments = arcSegments(float(maxRadius), 90.0f);
+
+    const Mesh& mesh = getRectMesh(key);
+
+    // Rect corners, in the same order as Mesh::corners
+    const SDL_FPoint anchors[4] = {
+        { float(rect.x),          float(rect.y) },
+        { float(rect.x + rect.w), float(rect.y) },
+        { float(rect.x + rect.w), float(rect.y + rect.h) },
+        { float(rect.x),          float(rect.y + rect.h) }
+    };
+
+    SDL_FColor fcol = TO_FCOLOR(color);
+
+    size_t n = mesh.points.size();
+    scratch.resize(n);
+    for(size_t i = 0; i < n; i++){
+        const SDL_FPoint& a = anchors[mesh.corners[i]];
+        scratch[i] = { { a.x + mesh.points[i].x, a.y + mesh.points[i].y }, fcol, {0, 0} };
+    }
+
+    DrawList::geometry(
+        nullptr,
+        scratch.data(), static_cast<int>(n),
+        mesh.indices.data(), static_cast<int>(mesh.indices.size())
+    );
+}
+
+
+
+void ShapeCache::setMaxError(float px){
+    MAX_ERROR = std::max(0.01f, px);
+}
+
+void ShapeCache::clear(){
+    quarterArcs.clear();
+    circleMeshes.clear();
+    rectMeshes.clear();
+}
@@ -7,27 +7,19 @@ void GUI::Text(
     SDL_Rect& dRect, 
     const SDL_Color& color
 ) {
+    PROFILE_ZONE("GUI::Text");
     if(dRect.w < 1 && dRect.h < 1) return;
 
     if(dRect.h == -1) dRect.h = calcTextHeight(title, dRect.w);
     if(dRect.w == -1) dRect.w = calcTextWidth(title, dRect.h);
 
-    LoadedText* textPointer = nullptr;
-    string id = getTextId(title, dRect.h, color);
+    // Glyphs from the atlas, no texture per string
+    if(GlyphAtlas::isEnabled() && drawGlyphText(title, dRect.h, dRect, color)) return;
 
-    auto it = loadedTexts.find(id);
-    if (it != loadedTexts.end()) {
-        // Save the pointer to that LoadedText item
-        textPointer = &it->second;
-        
-        // Update with the current frame
-        textPointer->lastUsedFrame = Sys::getCurrentFrame();
-    } else {
-        textPointer = loadNewText(title, dRect.h, color);
-    }
+    LoadedText* textPointer = getText(title, dRect.h);
 
-    // Render the texture
-    GUI::Image(textPointer->td, dRect);
+    // Render the white texture in the color, async texts show up once they're rendered
+    if(!textPointer->pending) GUI::Image(textPointer->td.getTexture(), nullptr, dRect, color);
 }
 
 
@@ -36,11 +28,14 @@ void GUI::TextDynamic(
     SDL_Rect& dRect, 
     const SDL_Color& color
 ) {
+    PROFILE_ZONE("GUI::TextDynamic");
     if(dRect.w < 1 && dRect.h < 1) return;
 
     if(dRect.h == -1) dRect.h = calcTextHeight(title, dRect.w);
     if(dRect.w == -1) dRect.w = calcTextWidth(title, dRect.h);
 
+    if(GlyphAtlas::isEnabled() && drawGlyphText(title, dRect.h, dRect, color)) return;
+
     // Create the texture
     TextureData td;
     int err = TM::createTextTexture(td, title, dRect.h, color);
@@ -51,40 +46,192 @@ void GUI::TextDynamic(
 }
 
 
-int GUI::calcTextWidth(
-    const string& text,
-    int textHeight
+void GUI::TextDynamic(
+    const string& id,
+    const string& title, 
+    SDL_Rect& dRect, 
+    const SDL_Color& color
 ) {
-    // Ensure that the font is valid.
+    PROFILE_ZONE("GUI::TextDynamic");
+    if(dRect.w < 1 && dRect.h < 1) return;
+
+    if(dRect.h == -1) dRect.h = calcTextHeight(title, dRect.w);
+    if(dRect.w == -1) dRect.w = calcTextWidth(title, dRect.h);
+
+    if(GlyphAtlas::isEnabled() && drawGlyphText(title, dRect.h, dRect, color)) return;
+
+    auto it = dynamicTexts.find(id);
+    if(it == dynamicTexts.end()){
+        it = dynamicTexts.insert({id, DynamicText{nullptr, 0, 0, "", 0, 0}}).first;
+    }
+
+    DynamicText& dt = it->second;
+    dt.lastUsedFrame = Sys::getCurrentFrame();
+    if(!updateDynamicText(dt, title, dRect.h)) return;
+
+    // Only the part with the text
+    SDL_Rect src = {0, 0, dt.width, dt.height};
+    GUI::Image(dt.texture, &src, dRect, color);
+}
+
+
+bool GUI::updateDynamicText(
+    DynamicText& dt,
+    const string& title,
+    int fontSize
+) {
+    // Color changes don't count, it's applied when drawing
+    if(dt.texture != nullptr && dt.fontSize == fontSize && dt.title == title) return true;
+
     if (Sys::fontPath == "") {
         Sys::printf_err(SYS_FONT_NOT_INITED);
         exit(EXIT_FAILURE);
     }
 
-    TTF_Font* font = Sys::getFont(textHeight);
+    TTF_Font* font = Sys::getFont(fontSize);
+    if(font == nullptr) return false;
 
-    // Measure the text using the currently active font.
-    int width = 0, height = 0;
-    TTF_GetStringSize(
-        font, 
-        text.c_str(), 
-        text.size(),
-        &width,
-        &height
-    );
+    SDL_Surface* surface = TTF_RenderText_Blended(font, title.c_str(), title.size(), SDL_COLOR_WHITE);
+    if(surface == nullptr){
+        CHECK_ERROR(TM_SURFACE_CREATE_ERROR);
+        return false;
+    }
+    if(surface->format != SDL_PIXELFORMAT_RGBA32){
+        SDL_Surface* converted = SDL_ConvertSurface(surface, SDL_PIXELFORMAT_RGBA32);
+        SDL_DestroySurface(surface);
+        if(converted == nullptr){
+            CHECK_ERROR(TM_SURFACE_CONVERT_ERROR);
+            return false;
+        }
+        surface = converted;
+    }
 
-    int currentFontHeight = TTF_GetFontHeight(font);
-    float scale = static_cast<float>(textHeight) / currentFontHeight;
-    int textWidth = static_cast<int>(width * scale);
+    // REALLOCATE, ONLY IF IT DOESN'T FIT -------------------------------------------
+    int texWidth = 0, texHeight = 0;
+    if(dt.texture){
+        SDL_PropertiesID prop = SDL_GetTextureProperties(dt.texture);
+        texWidth = (int)SDL_GetNumberProperty(prop, SDL_PROP_TEXTURE_WIDTH_NUMBER, 0);
+        texHeight = (int)SDL_GetNumberProperty(prop, SDL_PROP_TEXTURE_HEIGHT_NUMBER, 0);
+    }
 
-    // Return the scaled width.
-    return textWidth;
+    // Commands drawn earlier this frame would sample the new pixels. Flushing them
+    // would undo the batching (and with damage tracking the window commands wait for
+    // the end of the frame anyway), so they keep the old texture (destroyTexture
+    // waits for them) and this gets another one from the pool
+    bool inUse = DrawList::hasPending();
+
+    if(surface->w > texWidth || surface->h > texHeight || inUse){
+        // Headroom, so a counter gaining a digit doesn't reallocate again
+        int w = std::max(surface->w + surface->w / 2, texWidth);
+        int h = std::max(surface->h + surface->h / 4, texHeight);
+
+        // From the pool, a text changing every frame recycles its old textures
+        if(dt.texture) TM::destroyTexture(dt.texture);
+        dt.texture = TM::acquireTexture(SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STREAMING, w, h);
+        if(dt.texture == nullptr){
+            SDL_DestroySurface(surface);
+            CHECK_ERROR(TM_TEXTURE_CREATE_ERROR);
+            return false;
+        }
+        SDL_SetTextureBlendMode(dt.texture, SDL_BLENDMODE_BLEND);
+        SDL_SetTextureScaleMode(dt.texture, SDL_SCALEMODE_LINEAR);
+        TM::setTextureCategory(dt.texture, TextureCategory::TEXT);
+    }
+
+    // WRITE THE PIXELS IN PLACE ----------------------------------------------------------
+    SDL_Rect rect = {0, 0, surface->w, surface->h};
+    void* pixels = nullptr;
+    int pitch = 0;
+    if(!SDL_LockTexture(dt.texture, &rect, &pixels, &pitch)){
+        SDL_DestroySurface(surface);
+        CHECK_ERROR(TM_TEXTURE_UPDATE_ERROR);
+        return false;
+    }
+
+    for(int y = 0; y < surface->h; y++){
+        memcpy(
+            static_cast<Uint8*>(pixels) + y * pitch,
+            static_cast<const Uint8*>(surface->pixels) + y * surface->pitch,
+            size_t(surface->w) * 4
+        );
+    }
+    SDL_UnlockTexture(dt.texture);
+
+    Sys::counters.bytesUploaded += Uint64(surface->w) * surface->h * 4;
+    DrawList::invalidateTexture(dt.texture);
+
+    dt.width = surface->w;
+    dt.height = surface->h;
+    dt.title = title;
+    dt.fontSize = fontSize;
+
+    SDL_DestroySurface(surface);
+    return true;
 }
 
 
-int GUI::calcTextHeight(
+// TEXT METRICS ---------------------------------------------------------------
+GUI::TextMetrics GUI::measureTextWith(
+    TTF_Font* font,
     const string& text,
-    int textWidth
+    int fontSize
+) {
+    uint64_t hash = hashMix(hashBytes(text.data(), text.size()), uint64_t(uint32_t(fontSize)));
+
+    auto range = textMetrics.equal_range(hash);
+    for(auto it = range.first; it != range.second; it++){
+        CachedMetrics* cm = it->second.get();
+        if(cm->fontSize != fontSize || cm->text != text) continue;
+
+        // Move it to the front of the LRU list
+        if(cm != metricsFront){
+            cm->lruPrev->lruNext = cm->lruNext;
+            if(cm->lruNext) cm->lruNext->lruPrev = cm->lruPrev;
+            else metricsBack = cm->lruPrev;
+
+            cm->lruPrev = nullptr;
+            cm->lruNext = metricsFront;
+            metricsFront->lruPrev = cm;
+            metricsFront = cm;
+        }
+        return cm->metrics;
+    }
+
+    // Not cached, only now the font is needed
+    TextMetrics m = {0, 0, 0, 0};
+    if(font == nullptr) font = Sys::getFont(fontSize);
+    if(font == nullptr) return m;
+
+    TTF_GetStringSize(font, text.c_str(), text.size(), &m.width, &m.height);
+    m.ascent = TTF_GetFontAscent(font);
+    m.lineHeight = TTF_GetFontHeight(font);
+
+    // Full, the one that wasn't measured the longest goes
+    if(textMetrics.size() >= MAX_TEXT_METRICS && metricsBack != nullptr){
+        CachedMetrics* oldest = metricsBack;
+        metricsBack = oldest->lruPrev;
+        if(metricsBack) metricsBack->lruNext = nullptr;
+        else metricsFront = nullptr;
+
+        auto old = textMetrics.equal_range(oldest->hash);
+        for(auto it = old.first; it != old.second; it++){
+            if(it->second.get() == oldest){ textMetrics.erase(it); break; }
+        }
+    }
+
+    auto cm = make_unique<CachedMetrics>(CachedMetrics{text, fontSize, m, hash, nullptr, metricsFront});
+    if(metricsFront) metricsFront->lruPrev = cm.get();
+    metricsFront = cm.get();
+    if(metricsBack == nullptr) metricsBack = cm.get();
+
+    textMetrics.emplace(hash, std::move(cm));
+    return m;
+}
+
+
+GUI::TextMetrics GUI::measureText(
+    const string& text,
+    int fontSize
 ) {
     // Ensure that the font is valid.
     if (Sys::fontPath == "") {
@@ -92,43 +239,207 @@ int GUI::calcTextHeight(
         exit(EXIT_FAILURE);
     }
 
-    TTF_Font* font = Sys::getFont(64);
+    return measureTextWith(nullptr, text, fontSize);
+}
+
+
+void GUI::measureTexts(
+    const vector<string>& texts,
+    int fontSize,
+    vector<TextMetrics>& out
+) {
+    if (Sys::fontPath == "") {
+        Sys::printf_err(SYS_FONT_NOT_INITED);
+        exit(EXIT_FAILURE);
+    }
+
+    // One font lookup for all of them
+    TTF_Font* font = Sys::getFont(fontSize);
+
+    out.resize(texts.size());
+    for(size_t i = 0; i < texts.size(); i++){
+        out[i] = measureTextWith(font, texts[i], fontSize);
+    }
+}
+
+
+void GUI::clearTextMetrics(){
+    textMetrics.clear();
+    metricsFront = metricsBack = nullptr;
+}
+
+
+int GUI::calcTextWidth(
+    const string& text,
+    int textHeight
+) {
+    TextMetrics m = measureText(text, textHeight);
+    if(m.lineHeight <= 0) return 0;
+
+    // Hinting makes the widths slightly different at every size,
+    // so it's measured at the exact size and only corrected to textHeight
+    float scale = static_cast<float>(textHeight) / m.lineHeight;
+    int textWidth = static_cast<int>(m.width * scale);
+
+    // Return the scaled width.
+    return textWidth;
+}
+
+
+int GUI::calcTextHeight(
+    const string& text,
+    int textWidth
+) {
+    // Measured once at the reference size and scaled linearly,
+    // the result is a font size so it doesn't have to be exact
+    TextMetrics m = measureText(text, METRICS_REFERENCE_SIZE);
+    if(m.width <= 0) return 0;
 
-    // Measure the text's dimensions at font size 64.
-    int width = 0, height = 0;
-    TTF_GetStringSize(
-        font, 
-        text.c_str(), 
-        text.size(),
-        &width,
-        &height
-    );
-    
     // Calculate the scale factor based on the desired text width.
     // For example, if measuredWidth is 200px and textWidth is 100px, the scale factor is 0.5.
-    float scaleFactor = static_cast<float>(textWidth) / width;
+    float scaleFactor = static_cast<float>(textWidth) / m.width;
     
     // The new height is the measured height scaled accordingly.
-    int requiredHeight = static_cast<int>(height * scaleFactor);
+    int requiredHeight = static_cast<int>(m.height * scaleFactor);
     return requiredHeight;
 }
 
 
-string GUI::getTextId(
-    const string& title, 
-    int fontSize, 
-    SDL_Color color
+bool GUI::drawGlyphText(
+    const string& text,
+    int fontSize,
+    const SDL_Rect& dRect,
+    const SDL_Color& color
 ) {
-    // id = "HelloWorld_24#ffffffff"
-    // id = text_fontSize#color
-    return title + "_" + to_string(fontSize) + sdlColor2hex(color);
+    if(activeContainer.empty()){
+        return GlyphAtlas::draw(text, fontSize, TO_FRECT(dRect), color);
+    }
+
+    // Same as GUI::Rect, the text is moved into the container and clipped by it
+    auto container = getContainerState(activeContainer);
+    container->contentHeight = std::max(dRect.y + dRect.h, container->contentHeight);
+
+    // Scrolled out of the view, nothing to draw
+    if(dRect.y + dRect.h <= container->scrollOffset) return true;
+    if(dRect.y >= container->scrollOffset + container->dRect.h) return true;
+
+    SDL_FRect absRect = {
+        float(dRect.x + container->dRect.x),
+        float(dRect.y + container->dRect.y - container->scrollOffset),
+        float(dRect.w),
+        float(dRect.h)
+    };
+
+    DrawList::setClipRect(&container->dRect);
+    bool drawn = GlyphAtlas::draw(text, fontSize, absRect, color);
+    DrawList::setClipRect(nullptr);
+
+    return drawn;
 }
 
 
-GUI::LoadedText* GUI::loadNewText(
-    string title,
+bool GUI::drawGlyphRun(
+    const vector<Uint32>& glyphs,
+    const vector<int>& carets,
     int fontSize,
-    SDL_Color color
+    float scale,
+    const SDL_Rect& textRect,
+    int scrollX,
+    const SDL_Color& color
+) {
+    if(!GlyphAtlas::isEnabled()) return false;
+    if(glyphs.empty()) return true;
+
+    // Only the glyphs that end up in textRect, found in the carets
+    int viewStart = static_cast<int>(scrollX / scale);
+    int viewEnd = static_cast<int>((scrollX + textRect.w) / scale) + 1;
+
+    size_t first = std::upper_bound(carets.begin(), carets.end(), viewStart) - carets.begin();
+    size_t last = std::lower_bound(carets.begin(), carets.end(), viewEnd) - carets.begin() + 1;
+
+    // Glyphs can stick out of their advance a bit, the clip rect cuts them
+    if(first > 0) first--;
+
+    SDL_FPoint origin = { float(textRect.x - scrollX), float(textRect.y) };
+    SDL_Rect clip = textRect;
+
+    if(!activeContainer.empty()){
+        // Moved into the container, like GUI::Image does, and clipped by it too
+        auto container = getContainerState(activeContainer);
+        origin.x += container->dRect.x;
+        origin.y += container->dRect.y - container->scrollOffset;
+        clip.x += container->dRect.x;
+        clip.y += container->dRect.y - container->scrollOffset;
+
+        if(!SDL_GetRectIntersection(&clip, &container->dRect, &clip)) return true;
+    }
+
+    DrawList::setClipRect(&clip);
+    bool drawn = GlyphAtlas::drawRun(glyphs, carets, first, last, fontSize, origin, scale, color);
+    DrawList::setClipRect(nullptr);
+
+    return drawn;
+}
+
+
+// TEXT CACHE -----------------------------------------------------------------
+uint64_t GUI::hashText(
+    const string& title,
+    int fontSize
+) {
+    uint64_t h = hashBytes(title.data(), title.size());
+    return hashMix(h, uint64_t(uint32_t(fontSize)));
+}
+
+
+GUI::LoadedText* GUI::getText(
+    const string& title,
+    int fontSize
+) {
+    LoadedText* text = findText(hashText(title, fontSize), title, fontSize);
+
+    if(text == nullptr){
+        Sys::counters.textCacheMisses++;
+        return loadNewText(title, fontSize);
+    }
+    Sys::counters.textCacheHits++;
+
+    text->lastUsedFrame = Sys::getCurrentFrame();
+
+    // Move it to the front of the LRU list
+    if(text != lruFront){
+        text->lruPrev->lruNext = text->lruNext;
+        if(text->lruNext) text->lruNext->lruPrev = text->lruPrev;
+        else lruBack = text->lruPrev;
+
+        text->lruPrev = nullptr;
+        text->lruNext = lruFront;
+        lruFront->lruPrev = text;
+        lruFront = text;
+    }
+
+    return text;
+}
+
+
+GUI::LoadedText* GUI::findText(
+    uint64_t hash,
+    const string& title,
+    int fontSize
+) {
+    // Usually there is only one entry with this hash, the rest are collisions
+    auto range = loadedTexts.equal_range(hash);
+    for(auto it = range.first; it != range.second; it++){
+        LoadedText* t = it->second.get();
+        if(t->fontSize == fontSize && t->title == title) return t;
+    }
+    return nullptr;
+}
+
+
+GUI::LoadedText* GUI::loadNewText(
+    const string& title,
+    int fontSize
 ) {
     // If there are more elements then allowed remove the oldest
     if((int)loadedTexts.size() >= MAX_LOADED_TEXTS && MAX_LOADED_TEXTS > 0){
@@ -136,44 +447,102 @@ GUI::LoadedText* GUI::loadNewText(
     }
 
     // FIll the data
-    LoadedText newText;
-    newText.title = title;
-    newText.fontSize = fontSize;
-    newText.color = color;
-    newText.lastUsedFrame = Sys::getCurrentFrame();
+    auto newText = make_unique<LoadedText>();
+    newText->title = title;
+    newText->fontSize = fontSize;
+    newText->lastUsedFrame = Sys::getCurrentFrame();
+    newText->hash = hashText(title, fontSize);
+
+    // Create the texture, or let the workers render it
+    if(asyncText){
+        newText->pending = true;
+    } else {
+        int err = TM::createTextTexture(
+            newText->td, 
+            newText->title, 
+            newText->fontSize, 
+            SDL_COLOR_WHITE
+        );
+        CHECK_ERROR(err);
+
+        SDL_Texture* tex = newText->td.getTexture();
+        if(tex != nullptr){
+            newText->bytes = size_t(newText->td.getWidth()) * newText->td.getHeight() * SDL_BYTESPERPIXEL(newText->td.getFormat());
+        }
+    }
 
-    // Create the texture
-    int err = TM::createTextTexture(
-        newText.td, 
-        newText.title, 
-        newText.fontSize, 
-        newText.color
-    );
-    CHECK_ERROR(err);
+    // Insert the item at the front of the LRU list
+    LoadedText* text = newText.get();
+    loadedTexts.emplace(text->hash, std::move(newText));
+    textCacheBytes += text->bytes;
+
+    text->lruNext = lruFront;
+    if(lruFront) lruFront->lruPrev = text;
+    lruFront = text;
+    if(lruBack == nullptr) lruBack = text;
+
+    if(text->pending) queueText(text);
 
-    // Insert the item
-    loadedTexts.insert({newText.getId(), newText});
+    // Over the budget, make room from the back (but keep the new one)
+    while(textCacheBudget > 0 && textCacheBytes > textCacheBudget && lruBack != text){
+        removeOldestText();
+    }
 
-    // Return the pointer to the item
-    return &(loadedTexts.at(newText.getId()));
+    return text;
 }
 
 
-void GUI::removeOldestText(){
-    if (loadedTexts.empty()) return;
-
-    // Find the map‐element whose LoadedText::lastUsedFrame is smallest
-    auto it = std::min_element(
-        loadedTexts.begin(), 
-        loadedTexts.end(),
-        [](auto const &a, auto const &b) {
-            return a.second.lastUsedFrame < b.second.lastUsedFrame;
+void GUI::removeText(LoadedText* text){
+    if(text->lruPrev) text->lruPrev->lruNext = text->lruNext;
+    else lruFront = text->lruNext;
+    if(text->lruNext) text->lruNext->lruPrev = text->lruPrev;
+    else lruBack = text->lruPrev;
+
+    textCacheBytes -= text->bytes;
+
+    // Destroys the texture, once nothing else holds its TextureData
+    auto range = loadedTexts.equal_range(text->hash);
+    for(auto it = range.first; it != range.second; it++){
+        if(it->second.get() == text){
+            loadedTexts.erase(it);
+            return;
         }
-    );
+    }
+}
+
+
+void GUI::removeOldestText(){
+    if(lruBack != nullptr) removeText(lruBack);
+}
+
+
+void GUI::DestroyTextDynamic(const string& id){
+    auto it = dynamicTexts.find(id);
+    if(it == dynamicTexts.end()) return;
+
+    if(it->second.texture) TM::destroyTexture(it->second.texture);
+    dynamicTexts.erase(it);
+}
+
+
+void GUI::sweepDynamicTexts(){
+    int frame = Sys::getCurrentFrame();
+    std::erase_if(dynamicTexts, [frame](auto& e){
+        if(frame - e.second.lastUsedFrame <= DYNAMIC_TEXT_MAX_AGE) return false;
+        if(e.second.texture) TM::destroyTexture(e.second.texture);
+        return true;
+    });
+}
+
+
+void GUI::sweepTexts(){
+    sweepDynamicTexts();
+    if(textCacheMaxAge <= 0) return;
 
-    // Erase it
-    if (it != loadedTexts.end()) {
-        loadedTexts.erase(it);
+    // The back of the list is the oldest, stop at the first one still in use
+    int frame = Sys::getCurrentFrame();
+    while(lruBack != nullptr && frame - lruBack->lastUsedFrame > textCacheMaxAge){
+        removeText(lruBack);
     }
 }
 
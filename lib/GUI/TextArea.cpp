@@ -0,0 +1,399 @@
+#include "gui.h"
+#include "../System/Sys.h"
+
+
+
+// Held keys repeat after KEY_REPEAT_DELAY, then every KEY_REPEAT_RATE (ms)
+static const Uint64 KEY_REPEAT_DELAY = 400;
+static const Uint64 KEY_REPEAT_RATE = 35;
+
+// Width of the scrollbar of the container, the text stays left of it
+static const int SCROLLBAR_WIDTH = 8;
+
+static bool isContinuationByte(char c){
+    return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+}
+
+
+
+/** TextArea
+ *
+ * A multi-line text field, the text is kept in a TextBuffer (piece
+ * table) so files of a few MB can be edited without copying them
+ * around. Only the lines inside of the view are laid out and drawn,
+ * the lines keep their glyph runs between frames (state->lines).
+ *
+ * The scrolling is done by a container with the id "TextArea-" + uniqueId,
+ * so the mouse wheel and the scrollbar work the same as in containers.
+ *
+ * @param uniqueId A unique string intrenaly used to itentify the field acrros diffrent frames
+ * @param dRect Where and what size should the field be rendered
+ * @param background SDL_Color of the field
+ * @param foreground SDL_Color of the text
+ * @return true if the text was changed this frame
+ */
+bool GUI::TextArea(
+    const string& uniqueId,
+    const SDL_Rect& dRect,
+    const SDL_Color& background,
+    const SDL_Color& foreground
+) {
+    PROFILE_ZONE("GUI::TextArea");
+
+    // COPY STYLES -------------------------------------------------------
+    int fontSize = GUI::pFontSize;
+    GUI::pFontSize = -1;
+    if(fontSize == -1) fontSize = 16;
+
+    PaddingRect paddingRect = pPaddingRect;
+    pPaddingRect = {-1, -1, -1, -1};
+
+    if(paddingRect.top == -1) paddingRect.top = 5;
+    if(paddingRect.right == -1) paddingRect.right = 5;
+    if(paddingRect.bottom == -1) paddingRect.bottom = 5;
+    if(paddingRect.left == -1) paddingRect.left = 5;
+
+
+    // FIND STATE --------------------------------------------------------
+    auto it = textAreaStates.find(uniqueId);
+    if(it == textAreaStates.end()){
+        it = textAreaStates.emplace(uniqueId, TextAreaState(uniqueId)).first;
+    }
+    TextAreaState* state = &it->second;
+
+    string containerId = "TextArea-" + uniqueId;
+    ContainerState* container = getContainerState(containerId);
+
+    // Every line is laid out at the same size, a new size means a new layout
+    if(state->layoutSize != fontSize){
+        state->lines.clear();
+        state->layoutSize = fontSize;
+
+        int lineHeight = measureText("", fontSize).lineHeight;
+        state->layoutScale = (lineHeight > 0) ? float(fontSize) / lineHeight : 1.f;
+    }
+
+    int rowHeight = fontSize;
+    int viewWidth = dRect.w - paddingRect.left - paddingRect.right - SCROLLBAR_WIDTH;
+    TextBuffer& text = state->text;
+    bool changed = false;
+
+
+    // EVENTS ------------------------------------------------------------
+    // Handled before drawing, so the frame already shows the edit
+    if(Mouse::wasReleasedLeft()){
+        SDL_Point m = Mouse::getAbsolutePos();
+        bool onScrollbar = m.x >= dRect.x + dRect.w - SCROLLBAR_WIDTH;
+
+        if(Mouse::isHovering(dRect) && !onScrollbar){
+            Keyboard::focus();
+            state->focused = true;
+
+            // The caret goes to the char closest to the click
+            int y = m.y - dRect.y - paddingRect.top + container->scrollOffset;
+            size_t line = std::min<size_t>(std::max(0, y) / rowHeight, text.lineCount() - 1);
+            int x = m.x - dRect.x - paddingRect.left + state->scrollX;
+
+            state->cursor = textAreaPosAt(state, line, static_cast<int>(x / state->layoutScale));
+        } else if(!Mouse::isHovering(dRect)){
+            Keyboard::unfocus();
+            state->focused = false;
+        }
+    }
+
+    // If Sys::Keyboard::unfocus() was runned but the field still wants the focus
+    if(state->focused && !Keyboard::isFocused()) Keyboard::focus();
+
+    // Pressed keys, and held keys every KEY_REPEAT_RATE after KEY_REPEAT_DELAY
+    auto repeats = [&](SDL_Scancode key){
+        Uint64 now = SDL_GetTicks();
+        if(Keyboard::wasPressed(key)){
+            state->repeatKey = key;
+            state->repeatAt = now + KEY_REPEAT_DELAY;
+            return true;
+        }
+
+        if(state->repeatKey != key) return false;
+        if(!Keyboard::isDown(key)){
+            state->repeatKey = SDL_SCANCODE_UNKNOWN;
+            return false;
+        }
+
+        // Frames have to keep coming while its held, even in idle mode
+        Sys::requestWakeUp();
+        if(now < state->repeatAt) return false;
+
+        state->repeatAt = now + KEY_REPEAT_RATE;
+        return true;
+    };
+
+    if(state->focused){
+        size_t cursorBefore = state->cursor;
+
+        if(Keyboard::getText() != ""){
+            editTextArea(state, state->cursor, 0, Keyboard::getText());
+            state->cursor += Keyboard::getText().size();
+            changed = true;
+        }
+
+        if(repeats(SDL_SCANCODE_RETURN)){
+            editTextArea(state, state->cursor, 0, "\n");
+            state->cursor++;
+            changed = true;
+        }
+
+        // The whole char, it can take up to 4 bytes in UTF-8
+        if(repeats(SDL_SCANCODE_BACKSPACE) && state->cursor > 0){
+            size_t start = state->cursor - 1;
+            while(start > 0 && isContinuationByte(text.at(start))) start--;
+
+            editTextArea(state, start, state->cursor - start, "");
+            state->cursor = start;
+            changed = true;
+        }
+
+        if(repeats(SDL_SCANCODE_DELETE) && state->cursor < text.size()){
+            size_t end = state->cursor + 1;
+            while(end < text.size() && isContinuationByte(text.at(end))) end++;
+
+            editTextArea(state, state->cursor, end - state->cursor, "");
+            changed = true;
+        }
+
+        if(repeats(SDL_SCANCODE_LEFT) && state->cursor > 0){
+            state->cursor--;
+            while(state->cursor > 0 && isContinuationByte(text.at(state->cursor))) state->cursor--;
+        }
+
+        if(repeats(SDL_SCANCODE_RIGHT) && state->cursor < text.size()){
+            state->cursor++;
+            while(state->cursor < text.size() && isContinuationByte(text.at(state->cursor))) state->cursor++;
+        }
+
+        // Up and down keep the caret at the same x, as close as the line allows
+        bool up = repeats(SDL_SCANCODE_UP);
+        bool down = repeats(SDL_SCANCODE_DOWN);
+        if(up || down){
+            size_t line = text.lineOf(state->cursor);
+            if((up && line > 0) || (down && line + 1 < text.lineCount())){
+                int x = textAreaCaretX(state, state->cursor);
+                state->cursor = textAreaPosAt(state, up ? line - 1 : line + 1, x);
+            }
+        }
+
+        if(repeats(SDL_SCANCODE_HOME)){
+            state->cursor = text.lineStart(text.lineOf(state->cursor));
+        }
+        if(repeats(SDL_SCANCODE_END)){
+            size_t line = text.lineOf(state->cursor);
+            state->cursor = text.lineStart(line) + text.lineLength(line);
+        }
+
+        if(state->cursor != cursorBefore || changed) state->followCursor = true;
+    }
+
+
+    // DRAW BACKGROUND ---------------------------------------------------
+    GUI::Rect(dRect, background);
+    GUI::Rect(dRect, SDL_COLOR_BLACK, 1);
+
+    beginContainer(containerId, dRect);
+
+    // Scrolls just enough for the caret to be in the view
+    if(state->followCursor){
+        int caretY = paddingRect.top + static_cast<int>(text.lineOf(state->cursor)) * rowHeight;
+        if(caretY - paddingRect.top < container->scrollOffset){
+            container->scrollOffset = caretY - paddingRect.top;
+        } else if(caretY + rowHeight + paddingRect.bottom > container->scrollOffset + dRect.h){
+            container->scrollOffset = caretY + rowHeight + paddingRect.bottom - dRect.h;
+        }
+        container->scrollOffset = std::max(0, container->scrollOffset);
+
+        int caretX = static_cast<int>(textAreaCaretX(state, state->cursor) * state->layoutScale);
+        if(caretX < state->scrollX) state->scrollX = caretX;
+        if(caretX > state->scrollX + viewWidth - 1) state->scrollX = caretX - viewWidth + 1;
+
+        state->followCursor = false;
+    }
+
+
+    // DRAW LINES --------------------------------------------------------
+    // Only the ones inside of the view, whatever the size of the text
+    size_t firstLine = std::max(0, container->scrollOffset - paddingRect.top) / rowHeight;
+    size_t lastLine = std::min<size_t>(
+        text.lineCount(),
+        (container->scrollOffset + dRect.h) / rowHeight + 1
+    );
+
+    // Without the atlas the lines are cached text textures, cut by the clip rect
+    SDL_Rect textClip = {dRect.x + paddingRect.left, dRect.y, viewWidth, dRect.h};
+
+    for(size_t l = firstLine; l < lastLine; l++){
+        TextAreaState::Line* line = getTextAreaLine(state, l);
+
+        SDL_Rect row = {paddingRect.left, paddingRect.top + static_cast<int>(l) * rowHeight, viewWidth, rowHeight};
+        if(drawGlyphRun(line->glyphs, line->carets, fontSize, state->layoutScale, row, state->scrollX, foreground)) continue;
+        if(line->text.empty()) continue;
+
+        SDL_Rect textRect = {row.x - state->scrollX, row.y, -1, rowHeight};
+        DrawList::setClipRect(&textClip);
+        GUI::Text(line->text, textRect, foreground);
+        DrawList::setClipRect(nullptr);
+    }
+
+    // Lines that left the view are forgotten, once there's enough of them
+    if(state->lines.size() > 2 * (lastLine - firstLine) + 64){
+        int frame = Sys::getCurrentFrame();
+        for(auto l = state->lines.begin(); l != state->lines.end();){
+            if(l->second.lastUsedFrame != frame) l = state->lines.erase(l);
+            else l++;
+        }
+    }
+
+
+    // CARET -------------------------------------------------------------
+    // Same blinking as in Input
+    if(state->focused){
+        Uint64 ticks = SDL_GetTicks();
+        Sys::requestWakeUp(static_cast<Uint32>(500 - ticks % 500));
+
+        size_t line = text.lineOf(state->cursor);
+        if((ticks / 500) % 2 && line >= firstLine && line < lastLine){
+            int x = static_cast<int>(textAreaCaretX(state, state->cursor) * state->layoutScale) - state->scrollX;
+            if(x >= 0 && x <= viewWidth){
+                SDL_Rect caret = {paddingRect.left + x, paddingRect.top + static_cast<int>(line) * rowHeight, 1, rowHeight};
+                GUI::Rect(caret, foreground);
+            }
+        }
+    }
+
+    // The lines that aren't drawn still count for the scrollbar
+    container->contentHeight = paddingRect.top + static_cast<int>(text.lineCount()) * rowHeight;
+    endContainer();
+
+    return changed;
+}
+
+
+
+// LINES ----------------------------------------------------------------------
+GUI::TextAreaState::Line* GUI::getTextAreaLine(TextAreaState* state, size_t line){
+    auto it = state->lines.find(line);
+    if(it == state->lines.end()){
+        TextAreaState::Line l;
+        state->text.getLine(line, l.text);
+        GlyphAtlas::layout(l.text, state->layoutSize, l.glyphs, l.carets);
+
+        it = state->lines.emplace(line, std::move(l)).first;
+    }
+
+    it->second.lastUsedFrame = Sys::getCurrentFrame();
+    return &it->second;
+}
+
+
+
+void GUI::editTextArea(
+    TextAreaState* state,
+    size_t pos,
+    size_t eraseLength,
+    const string& insert
+) {
+    TextBuffer& text = state->text;
+    size_t line = text.lineOf(pos);
+
+    // Lines move only if some '\n' come or go
+    bool linesMove = insert.find('\n') != string::npos;
+    if(eraseLength > 0 && text.lineOf(pos + eraseLength) != line) linesMove = true;
+
+    text.erase(pos, eraseLength);
+    text.insert(pos, insert);
+
+    if(!linesMove){
+        state->lines.erase(line);
+        return;
+    }
+
+    for(auto it = state->lines.begin(); it != state->lines.end();){
+        if(it->first >= line) it = state->lines.erase(it);
+        else it++;
+    }
+}
+
+
+
+int GUI::textAreaCaretX(TextAreaState* state, size_t pos){
+    TextBuffer& text = state->text;
+    size_t line = text.lineOf(pos);
+    TextAreaState::Line* l = getTextAreaLine(state, line);
+
+    // Chars before pos, the caret of the last one is where pos is
+    size_t column = pos - text.lineStart(line);
+    size_t chars = 0;
+    for(size_t i = 0; i < column && i < l->text.size(); i++){
+        if(!isContinuationByte(l->text[i])) chars++;
+    }
+
+    if(chars == 0 || l->carets.empty()) return 0;
+    return l->carets[std::min(chars, l->carets.size()) - 1];
+}
+
+
+
+size_t GUI::textAreaPosAt(TextAreaState* state, size_t line, int x){
+    TextAreaState::Line* l = getTextAreaLine(state, line);
+    const vector<int>& carets = l->carets;
+
+    // The caret closest to x, the one before the first char is at 0
+    size_t chars = std::upper_bound(carets.begin(), carets.end(), x) - carets.begin();
+    if(chars < carets.size()){
+        int before = (chars == 0) ? 0 : carets[chars - 1];
+        if(carets[chars] - x < x - before) chars++;
+    }
+
+    // Back from chars to bytes
+    size_t byte = 0;
+    for(size_t c = 0; byte < l->text.size(); byte++){
+        if(isContinuationByte(l->text[byte])) continue;
+        if(c == chars) break;
+        c++;
+    }
+
+    return state->text.lineStart(line) + byte;
+}
+
+
+
+void GUI::setTextAreaValue(const string& uniqueId, const string& value){
+    auto it = textAreaStates.find(uniqueId);
+    if(it == textAreaStates.end()){
+        it = textAreaStates.emplace(uniqueId, TextAreaState(uniqueId)).first;
+    }
+
+    TextAreaState& state = it->second;
+    state.text.assign(value);
+    state.cursor = 0;
+    state.scrollX = 0;
+    state.lines.clear();
+
+    getContainerState("TextArea-" + uniqueId)->scrollOffset = 0;
+}
+
+
+
+const TextBuffer* GUI::getTextAreaValue(const string& uniqueId){
+    auto it = textAreaStates.find(uniqueId);
+    if(it == textAreaStates.end()) return nullptr;
+    return &it->second.text;
+}
+
+
+
+void GUI::DestroyTextArea(const string& uniqueId){
+    auto it = textAreaStates.find(uniqueId);
+    if(it == textAreaStates.end()) return;
+
+    if(it->second.focused) Keyboard::unfocus();
+    textAreaStates.erase(it);
+    containerStates.erase("TextArea-" + uniqueId);
+}
@@ -0,0 +1,216 @@
+#include "gui.h"
+#include "../System/Sys.h"
+
+
+
+static void appendLines(const string& text, size_t offset, vector<size_t>& lines){
+    for(size_t i = 0; i < text.size(); i++){
+        if(text[i] == '\n') lines.push_back(offset + i);
+    }
+}
+
+
+
+TextBuffer::TextBuffer(const string& text){
+    assign(text);
+}
+
+
+
+void TextBuffer::assign(const string& text){
+    original = text;
+    added.clear();
+
+    originalLines.clear();
+    addedLines.clear();
+    appendLines(original, 0, originalLines);
+
+    pieces.clear();
+    if(!original.empty()){
+        pieces.push_back({false, 0, original.size(), originalLines.size()});
+    }
+
+    reindex();
+}
+
+
+
+// INDEX ----------------------------------------------------------------------
+size_t TextBuffer::countLines(const Piece& p, size_t start, size_t length) const {
+    const vector<size_t>& lines = bufferLines(p);
+    auto first = std::lower_bound(lines.begin(), lines.end(), start);
+    auto last = std::lower_bound(first, lines.end(), start + length);
+    return last - first;
+}
+
+
+
+void TextBuffer::reindex(){
+    // Only the pieces are walked, never the text
+    pieceStart.resize(pieces.size());
+    linesBefore.resize(pieces.size());
+
+    total = 0;
+    totalLines = 0;
+    for(size_t i = 0; i < pieces.size(); i++){
+        pieceStart[i] = total;
+        linesBefore[i] = totalLines;
+        total += pieces[i].length;
+        totalLines += pieces[i].lines;
+    }
+}
+
+
+
+size_t TextBuffer::findPiece(size_t pos) const {
+    // Last piece that starts at or before pos
+    auto it = std::upper_bound(pieceStart.begin(), pieceStart.end(), pos);
+    if(it == pieceStart.begin()) return 0;
+    return (it - pieceStart.begin()) - 1;
+}
+
+
+
+size_t TextBuffer::split(size_t pos){
+    if(pos >= total) return pieces.size();
+
+    size_t i = findPiece(pos);
+    size_t offset = pos - pieceStart[i];
+    if(offset == 0) return i;
+
+    Piece& p = pieces[i];
+    Piece right = {p.added, p.start + offset, p.length - offset, 0};
+    right.lines = countLines(right, right.start, right.length);
+
+    p.length = offset;
+    p.lines -= right.lines;
+
+    pieces.insert(pieces.begin() + i + 1, right);
+    reindex();
+    return i + 1;
+}
+
+
+
+// EDITING --------------------------------------------------------------------
+void TextBuffer::insert(size_t pos, const string& text){
+    if(text.empty()) return;
+    pos = std::min(pos, total);
+
+    size_t start = added.size();
+    added += text;
+    appendLines(text, start, addedLines);
+
+    size_t i = split(pos);
+
+    // Typing right after the last insert, the piece before just grows
+    if(i > 0){
+        Piece& prev = pieces[i - 1];
+        if(prev.added && prev.start + prev.length == start){
+            prev.length += text.size();
+            prev.lines += countLines(prev, start, text.size());
+            reindex();
+            return;
+        }
+    }
+
+    Piece p = {true, start, text.size(), 0};
+    p.lines = countLines(p, start, text.size());
+    pieces.insert(pieces.begin() + i, p);
+    reindex();
+}
+
+
+
+void TextBuffer::erase(size_t pos, size_t length){
+    if(pos >= total || length == 0) return;
+    length = std::min(length, total - pos);
+
+    // Pieces from the one starting at pos up to the one starting
+    // at pos + length go away. Splitting at pos moves the end by one
+    size_t last = split(pos + length);
+    size_t count = pieces.size();
+    size_t first = split(pos);
+    if(pieces.size() != count) last++;
+
+    pieces.erase(pieces.begin() + first, pieces.begin() + last);
+    reindex();
+}
+
+
+
+// READING --------------------------------------------------------------------
+size_t TextBuffer::lineStart(size_t line) const {
+    if(line == 0 || pieces.empty()) return 0;
+    if(line > totalLines) return total;
+
+    // The piece with the line-th '\n' in it
+    auto it = std::lower_bound(linesBefore.begin(), linesBefore.end(), line);
+    size_t i = (it - linesBefore.begin()) - 1;
+
+    const Piece& p = pieces[i];
+    const vector<size_t>& lines = bufferLines(p);
+    size_t first = std::lower_bound(lines.begin(), lines.end(), p.start) - lines.begin();
+    size_t newline = lines[first + (line - linesBefore[i] - 1)];
+
+    return pieceStart[i] + (newline - p.start) + 1;
+}
+
+
+
+size_t TextBuffer::lineLength(size_t line) const {
+    size_t start = lineStart(line);
+    size_t end = (line < totalLines) ? lineStart(line + 1) - 1 : total;
+    return end - start;
+}
+
+
+
+size_t TextBuffer::lineOf(size_t pos) const {
+    if(pieces.empty()) return 0;
+    if(pos >= total) return totalLines;
+
+    size_t i = findPiece(pos);
+    const Piece& p = pieces[i];
+    return linesBefore[i] + countLines(p, p.start, pos - pieceStart[i]);
+}
+
+
+
+char TextBuffer::at(size_t pos) const {
+    if(pos >= total) return '\0';
+
+    size_t i = findPiece(pos);
+    const Piece& p = pieces[i];
+    return buffer(p)[p.start + (pos - pieceStart[i])];
+}
+
+
+
+void TextBuffer::getText(size_t pos, size_t length, string& out) const {
+    out.clear();
+    if(pos >= total) return;
+    length = std::min(length, total - pos);
+    out.reserve(length);
+
+    for(size_t i = findPiece(pos); i < pieces.size() && out.size() < length; i++){
+        const Piece& p = pieces[i];
+        size_t offset = (pos > pieceStart[i]) ? pos - pieceStart[i] : 0;
+        size_t n = std::min(p.length - offset, length - out.size());
+        out.append(buffer(p), p.start + offset, n);
+    }
+}
+
+
+
+void TextBuffer::getLine(size_t line, string& out) const {
+    getText(lineStart(line), lineLength(line), out);
+}
+
+
+
+string TextBuffer::toString() const {
+    string out;
+    getText(0, total, out);
+    return out;
+}
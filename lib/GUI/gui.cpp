@@ -23,6 +23,16 @@ string color2hex(const SDL_Color& color){
 
 
 void GUI::setMaxNumOfLoadedTextures(int num){ MAX_LOADED_TEXTS = num; }
+void GUI::setTextCacheBudget(size_t bytes){ textCacheBudget = bytes; }
+void GUI::setTextCacheMaxAge(int frames){ textCacheMaxAge = std::max(0, frames); }
+void GUI::setAsyncText(bool enabled, int workers, int uploadBudgetUs){
+    // New worker count takes effect when they are started again
+    if(workers != asyncTextWorkers) stopAsyncText();
+
+    asyncText = enabled;
+    asyncTextWorkers = std::max(1, workers);
+    textUploadBudgetNS = Uint64(std::max(0, uploadBudgetUs)) * 1000;
+}
 
 
 void GUI::pushFontSize(uint fontSize)    { pFontSize = fontSize; }
@@ -62,6 +72,10 @@ void GUI::setInputValue(string inputId, string newValue){
     }
 
     state->value = newValue;
+
+    // Laid out and rendered again with the next frame
+    state->layoutSize = 0;
+    state->change = true;
 }
 
 void GUI::pushOutlineStyle(int thickness, SDL_Color color){
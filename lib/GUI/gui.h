@@ -82,6 +82,717 @@ void drawThickLineSegment(const SDL_Point& p1, const SDL_Point& p2, const SDL_Co
 
 
 
+/**
+ * @brief DrawList, per-frame list of draw commands.
+ *
+ * Insted of every GUI primitive calling the renderer directly, they
+ * append their geometry to the DrawList, which is flushed by
+ * Sys::presentFrame (or earlier, whenever a TM function needs to read a
+ * texture the list might be drawing into). Textures destroyed trough
+ * TM::destroyTexture are not destroyed right away, the pending commands
+ * might still be using them: they are queued and destroyed by
+ * Sys::presentFrame DESTROY_DELAY_FRAMES frames later (see TM).
+ *
+ * While appending, the command is merged with the previous one if they
+ * can be drawn with a single SDL_RenderGeometry call: both are untextured
+ * or use the same texture, and they share the render target and the
+ * clip rect. Only consecutive commands are merged so the paint order
+ * stays exactly the same.
+ *
+ * Lines (1px) can't be expressed as geometry, so they break the batch.
+ *
+ * Immediate mode (DrawList::setImmediateMode(true)) turns this off
+ * and every command is sent to the renderer as soon as it's appended.
+ *
+ * DAMAGE TRACKING (DrawList::setDamageTracking(true)) is meant for UIs
+ * that are static most of the time. Every primitive drawn onto the
+ * window records its bounds and a hash of its inputs (vertices, colors,
+ * texture, clip). At the end of the frame the records are compared with
+ * the previous frame and only the regions that changed are cleared and
+ * redrawn into a persistent back-buffer texture, which is then copied
+ * onto the window. A frame in which nothing changed redraws nothing.
+ * While it's on, everything drawn onto the window has to go trough the
+ * GUI (or the DrawList), anything drawn with SDL directly is overwritten.
+ * It has no effect in immediate mode.
+ */
+class DrawList {
+    friend class Sys;
+    friend class GUI;
+    friend class TM;
+
+public:
+    /**
+     * @brief Counters of the last flushed frame.
+     *
+     * submittedCalls - renderer calls the GUI asked for (before merging)
+     * issuedCalls    - renderer calls actually made (after merging)
+     * damagedArea    - pixels redrawn, damage tracking only
+     * damagedRects   - regions redrawn, damage tracking only
+     */
+    struct Stats {
+        int submittedCalls;
+        int issuedCalls;
+        int vertices;
+        int indices;
+        int damagedArea;
+        int damagedRects;
+    };
+
+    /**
+     * @brief Appends triangles, same arguments as SDL_RenderGeometry.
+     * If indices is nullptr vertices are used sequentially.
+     */
+    static void geometry(
+        SDL_Texture* texture,
+        const SDL_Vertex* vertices,
+        int numVertices,
+        const int* indices,
+        int numIndices
+    );
+
+    /** @brief Appends a filled rect, as two triangles. */
+    static void fillRect(const SDL_FRect& rect, const SDL_Color& color);
+
+    /**
+     * @brief Appends a texture, same as SDL_RenderTexture.
+     * The colors of the texture are multiplied by tint.
+     */
+    static void texture(
+        SDL_Texture* texture,
+        const SDL_FRect* srcRect,
+        const SDL_FRect& dstRect,
+        const SDL_Color& tint = SDL_COLOR_WHITE
+    );
+
+    /** @brief Appends a 1px line. */
+    static void line(
+        float x1, float y1,
+        float x2, float y2,
+        const SDL_Color& color
+    );
+
+    /**
+     * @brief Sets the clip rect used by all of the following commands.
+     * Pass nullptr to disable clipping.
+     */
+    static void setClipRect(const SDL_Rect* rect);
+
+    /**
+     * @brief Sends all of the pending commands to the renderer.
+     * With damage tracking only the ones drawing into textures are
+     * sent, the rest has to wait for the end of the frame.
+     */
+    static void flush();
+
+    /** @brief Returns true if there are commands waiting for flush. */
+    static bool hasPending();
+
+    /**
+     * @brief Flushes and closes the frame counters.
+     * Called by Sys::presentFrame, only call it yourself if
+     * you present the frame without Sys::presentFrame.
+     */
+    static void endFrame();
+
+    static void setImmediateMode(bool immediate = true);
+    static bool isImmediateMode();
+
+    static void setDamageTracking(bool enabled = true);
+    static bool isDamageTracking();
+
+    /**
+     * @brief Damage tracking only, redraws the whole window next frame.
+     * Use it after changing something the DrawList can't see.
+     */
+    static void invalidate();
+
+    /**
+     * @brief Damage tracking only, marks the contents of the texture as
+     * changed, so everything that draws it gets redrawn. Call it if you
+     * modify a texture yourself (SDL_UpdateTexture, SDL_LockTexture...).
+     */
+    static void invalidateTexture(SDL_Texture* texture);
+
+    /** @brief Returns the counters of the last flushed frame. */
+    static Stats getStats();
+
+private:
+    enum class Kind {
+        GEOMETRY,
+        LINE
+    };
+
+    struct Command {
+        Kind kind;
+        SDL_Texture* texture;   // nullptr for untextured geometry
+        SDL_Texture* target;    // Render target at the time of appending
+        bool clipEnabled;
+        SDL_Rect clip;
+
+        int firstVertex;
+        int numVertices;
+        int firstIndex;
+        int numIndices;
+
+        SDL_FPoint p1, p2;      // LINE only
+        SDL_Color color;        // LINE only
+
+        SDL_Rect bounds;        // Damage tracking, window commands only
+    };
+
+    // Damage tracking, one per primitive drawn onto the window
+    struct DamageRecord {
+        SDL_Rect bounds;
+        uint64_t hash;
+    };
+
+    static inline vector<Command> commands;
+    static inline vector<SDL_Vertex> vertices;
+    static inline vector<int> indices;
+
+    static inline bool immediate = false;
+    static inline bool clipEnabled = false;
+    static inline SDL_Rect clip = {0, 0, 0, 0};
+
+    static inline Stats current = {};    // Being filled this frame
+    static inline Stats last = {};       // Last flushed frame
+
+    static void issue(const Command& cmd);
+
+    // Which commands replay() issues
+    enum class Replay {
+        ALL,
+        TARGETS,    // Only the ones drawing into textures
+        WINDOW      // Only the ones drawing onto the window
+    };
+
+    static void replay(Replay which, SDL_Texture* window, const SDL_Rect* limit);
+
+    // DAMAGE TRACKING ------------------------------------------------
+    static inline bool damageTracking = false;
+    static inline bool fullDamage = true;       // Redraw everything next frame
+    static inline SDL_Texture* backBuffer = nullptr;
+
+    static inline vector<DamageRecord> records;
+    static inline vector<DamageRecord> prevRecords;
+    static inline uint64_t sequenceHash = 0;    // Hash of the records in order
+    static inline uint64_t prevSequenceHash = 0;
+
+    // Changes whenever the texture's contents change, part of the record hash
+    static inline unordered_map<SDL_Texture*, uint64_t> textureGenerations;
+    static inline uint64_t generationCounter = 0;
+
+    static bool tracking();
+    static void record(const SDL_Rect& bounds, uint64_t hash, Command& cmd);
+    static void flushTargets();
+    static void presentDamage();
+    static void textureDestroyed(SDL_Texture* texture);
+};
+
+
+
+/**
+ * @brief ShapeCache, pre-tessellated meshes for circles, rings and
+ * rounded rects.
+ *
+ * Insted of computing cos/sin for every arc vertex on every call, the
+ * meshes are built once and stored in normalized form:
+ *  - circles and rings share a unit circle, keyed only by the segment
+ *    count, the radius (and thickness) are applied while drawing
+ *  - rounded rects are keyed by their radii, thickness and segment
+ *    count, every vertex is stored relative to one of the rect corners
+ *    so the same mesh fits a rect of any size
+ *
+ * Drawing only translates (and scales) the stored points, colors them
+ * and appends them to the DrawList. If the ShapeAtlas is enabled, shapes
+ * are drawn from it insted, the meshes are used only for the ones it
+ * can't draw.
+ *
+ * The segment count is picked from the on-screen radius, so that no
+ * chord is further than MAX_ERROR px away from the real arc.
+ *
+ * The rounded rect meshes are kept in a map with max capacity of
+ * MAX_MESHES, when its full the least recently used one gets removed.
+ */
+class ShapeCache {
+public:
+    /**
+     * @brief Returns how many segments an arc needs so that it doesn't
+     * deviate from the real curve by more then MAX_ERROR px.
+     *
+     * @param radius Radius of the arc in pixels
+     * @param degrees Angle that the arc covers (90 for a corner)
+     */
+    static int arcSegments(float radius, float degrees);
+
+    /**
+     * @brief Returns segments+1 points of a unit quarter circle,
+     * from 0 to 90 degrees. Computed only the first time.
+     */
+    static const vector<SDL_FPoint>& quarterArc(int segments);
+
+    /**
+     * @brief Draws a filled circle or a ring.
+     *
+     * @param center Center of the circle
+     * @param radius Radius in pixels
+     * @param thickness Ring thickness, -1 for filled
+     * @param color Color of the circle
+     */
+    static void circle(
+        const SDL_FPoint& center,
+        float radius,
+        int thickness,
+        const SDL_Color& color
+    );
+
+    /**
+     * @brief Draws a filled rounded rect or its outline.
+     * Radii must already be clamped to fit inside the rect.
+     *
+     * @param rect The rect
+     * @param radius Radius per corner
+     * @param thickness Outline thickness, -1 for filled
+     * @param color Color of the rect
+     */
+    static void roundedRect(
+        const SDL_Rect& rect,
+        const BorderRadiusRect& radius,
+        int thickness,
+        const SDL_Color& color
+    );
+
+    /** @brief Sets the max allowed distance between the arc and its chords, in px. */
+    static void setMaxError(float px);
+
+    /** @brief Removes all of the cached meshes. */
+    static void clear();
+
+private:
+    struct Mesh {
+        vector<SDL_FPoint> points;  // Unit space for circles, corner relative for rects
+        vector<Uint8> corners;      // Rects only, 0 TL, 1 TR, 2 BR, 3 BL
+        vector<int> indices;
+        int lastUsedFrame = 0;
+    };
+
+    // Circles only depend on the segment count
+    struct CircleMesh {
+        vector<SDL_FPoint> points;  // Unit circle, segments points
+        vector<int> fillIndices;    // Fan, center is an extra vertex at the end
+        vector<int> ringIndices;    // Outer points first, then inner
+    };
+
+    struct RectMeshKey {
+        uint radius[4];     // TL, TR, BR, BL
+        int thickness;
+        int segments;
+
+        bool operator==(const RectMeshKey& o) const {
+            return radius[0] == o.radius[0] && radius[1] == o.radius[1] &&
+                   radius[2] == o.radius[2] && radius[3] == o.radius[3] &&
+                   thickness == o.thickness && segments == o.segments;
+        }
+    };
+
+    struct RectMeshKeyHash {
+        size_t operator()(const RectMeshKey& k) const {
+            uint64_t h = FNV_OFFSET;
+            for(uint r : k.radius) h = hashMix(h, r);
+            h = hashMix(h, uint64_t(k.thickness));
+            h = hashMix(h, uint64_t(k.segments));
+            return static_cast<size_t>(h);
+        }
+    };
+
+    static inline unordered_map<int, vector<SDL_FPoint>> quarterArcs;
+    static inline unordered_map<int, CircleMesh> circleMeshes;
+    static inline unordered_map<RectMeshKey, Mesh, RectMeshKeyHash> rectMeshes;
+    static inline int MAX_MESHES = 256;
+
+    static inline float MAX_ERROR = 0.25f;
+
+    // Reused between draws, so vertices aren't allocated every call
+    static inline vector<SDL_Vertex> scratch;
+
+    static const CircleMesh& getCircleMesh(int segments);
+    static const Mesh& getRectMesh(const RectMeshKey& key);
+};
+
+
+
+/**
+ * @brief ShapeAtlas, an alternative way of drawing ShapeCache shapes.
+ *
+ * Insted of tessellating the arcs into triangles, the shape coverage
+ * (computed on the CPU from a signed distance function, with 1px of
+ * anti-aliasing) is rendered into a cell of a single atlas texture and
+ * the shape is drawn as textured quads sampling it:
+ *  - circles and rings are one quad, a cell per radius and thickness
+ *  - rounded rects are a nine-slice (max 9 quads) of a cell per
+ *    corner radii and thickness, corners are copied 1:1 and the
+ *    edges and the center are stretched, so any rect size can use it
+ *
+ * Every shape uses the same texture, so consecutive shapes end up in
+ * one DrawList batch no matter their size, color or radius. Only
+ * SDL_RenderGeometry with a texture is used, so it works on every
+ * renderer, including the software one.
+ *
+ * It is turned off by default, enable it with ShapeAtlas::setEnabled().
+ * Shapes that don't fit (radius over MAX_RADIUS, rect smaller then its
+ * corners) are still drawn by the ShapeCache meshes.
+ *
+ * When the atlas gets full it is cleared and filled again from scratch.
+ */
+class ShapeAtlas {
+    friend class Sys;
+
+public:
+    static void setEnabled(bool enabled = true);
+    static bool isEnabled();
+
+    /**
+     * @brief Draws a rounded rect (thickness -1 for filled).
+     * @return false if the shape can't be drawn from the atlas
+     */
+    static bool roundedRect(
+        const SDL_Rect& rect,
+        const BorderRadiusRect& radius,
+        int thickness,
+        const SDL_Color& color
+    );
+
+    /**
+     * @brief Draws a circle or a ring (thickness -1 for filled).
+     * @return false if the shape can't be drawn from the atlas
+     */
+    static bool circle(
+        const SDL_FPoint& center,
+        float radius,
+        int thickness,
+        const SDL_Color& color
+    );
+
+    /** @brief Destroys the atlas texture and forgets all of the cells. */
+    static void clear();
+
+private:
+    enum class CellKind {
+        RECT,
+        CIRCLE
+    };
+
+    struct CellKey {
+        CellKind kind;
+        uint radius[4];     // TL, TR, BR, BL, circles use only [0]
+        int thickness;
+
+        bool operator==(const CellKey& o) const {
+            return kind == o.kind &&
+                   radius[0] == o.radius[0] && radius[1] == o.radius[1] &&
+                   radius[2] == o.radius[2] && radius[3] == o.radius[3] &&
+                   thickness == o.thickness;
+        }
+    };
+
+    struct CellKeyHash {
+        size_t operator()(const CellKey& k) const {
+            uint64_t h = hashMix(FNV_OFFSET, static_cast<uint64_t>(k.kind));
+            for(uint r : k.radius) h = hashMix(h, r);
+            h = hashMix(h, uint64_t(k.thickness));
+            return static_cast<size_t>(h);
+        }
+    };
+
+    struct Cell {
+        SDL_Rect rect;      // Position inside of the atlas
+        int left, top, right, bottom;   // Nine-slice borders, rects only
+    };
+
+    static inline bool enabled = false;
+
+    static inline SDL_Texture* atlas = nullptr;
+    static inline int ATLAS_SIZE = 1024;
+    static inline int MAX_RADIUS = 64;
+
+    static inline unordered_map<CellKey, Cell, CellKeyHash> cells;
+
+    // Shelf packing, cells are placed left to right in rows (shelves)
+    static inline int shelfX = 0;
+    static inline int shelfY = 0;
+    static inline int shelfHeight = 0;
+
+    static const Cell* getCell(const CellKey& key);
+    static bool allocate(int w, int h, SDL_Rect& out);
+    static void reset();
+};
+
+
+
+/**
+ * @brief GlyphAtlas, draws text from glyphs packed into shared textures
+ * insted of rendering a texture for every (string, size, color).
+ *
+ * Every glyph is rasterized once per font size, in white, and packed
+ * into one of the atlas pages. A string is then drawn as a list of
+ * quads, one per glyph, with the color applied per vertex, so:
+ *  - changing strings (counters, tables of numbers) create no textures
+ *  - a color change doesn't rasterize anything
+ *  - consecutive texts end up in one DrawList batch
+ *
+ * Strings are laid out like TTF_RenderText_Blended lays them out
+ * (advances, kerning, left bearing of the first glyph) and stretched
+ * the same way the text textures were, so both modes look alike.
+ *
+ * It is on by default, GlyphAtlas::setEnabled(false) brings back the
+ * cached text textures (GUI::loadedTexts), for comparison.
+ *
+ * When all of the MAX_PAGES pages are full the atlas is cleared and
+ * filled again from scratch.
+ *
+ * PREBAKING. GlyphAtlas::bake renders the glyphs of some sizes ahead of
+ * time into a file (pages, glyph metrics and kerning), tied to the font
+ * by its hash. Passing that file to Sys::initFont maps it and the first
+ * frame draws those glyphs without FreeType rendering anything:
+ *
+ *      Sys::initFont("Lato.ttf", "lato.atlas");
+ *      if(!GlyphAtlas::hasBakedGlyphs()) GlyphAtlas::bake("lato.atlas", {14, 16, 24});
+ *
+ * The bake only happens on the first run (or after the font changed).
+ */
+class GlyphAtlas {
+    friend class Sys;
+
+public:
+    static void setEnabled(bool enabled = true);
+    static bool isEnabled();
+
+    /**
+     * @brief Size of the text at fontSize, as TTF_RenderText_Blended
+     * would render it.
+     * @return false if the font can't be opened
+     */
+    static bool measure(const string& text, int fontSize, int& width, int& height);
+
+    /**
+     * @brief Draws the text at fontSize, stretched into dst.
+     * @return false if the text can't be drawn from the atlas
+     */
+    static bool draw(
+        const string& text,
+        int fontSize,
+        const SDL_FRect& dst,
+        const SDL_Color& color
+    );
+
+    /**
+     * @brief Lays out text at fontSize after the run already in codepoints,
+     * appending every codepoint and the caret after it (pen position, kerning
+     * included). carets.back() is the width of the run. Needs only the font,
+     * GUI::Input keeps the run of its value and lays out just what was typed.
+     */
+    static void layout(
+        const string& text,
+        int fontSize,
+        vector<Uint32>& codepoints,
+        vector<int>& carets
+    );
+
+    /**
+     * @brief Draws codepoints [first, last) of a run made by layout, with
+     * the start of the run at origin (top of the line) and scaled by scale.
+     * Nothing gets cut, use DrawList::setClipRect for that.
+     * @return false if the run can't be drawn from the atlas
+     */
+    static bool drawRun(
+        const vector<Uint32>& codepoints,
+        const vector<int>& carets,
+        size_t first,
+        size_t last,
+        int fontSize,
+        SDL_FPoint origin,
+        float scale,
+        const SDL_Color& color
+    );
+
+    /** @brief Destroys the pages and forgets all of the glyphs. */
+    static void clear();
+
+    /**
+     * @brief Renders `glyphs` at every size of `sizes` and writes them into
+     * a glyph atlas file, then loads it. Needs only Sys::initFont, not the
+     * window, so it can run as a separate build step too.
+     * @return error code (0 means no error)
+     */
+    static int bake(
+        const string& path,
+        const vector<int>& sizes,
+        const string& glyphs = Sys::PREWARM_GLYPHS
+    );
+
+    /**
+     * @brief Loads a file made by GlyphAtlas::bake, replacing the current
+     * glyphs. Called by Sys::initFont. The pages are uploaded with the
+     * first draw, as the renderer might not exist yet.
+     * @return SYS_GLYPH_ATLAS_INVALID if it was baked for a different font
+     */
+    static int load(const string& path);
+
+    /** @brief True if glyphs from a baked file are loaded. */
+    static bool hasBakedGlyphs();
+
+private:
+    struct GlyphKey {
+        int fontSize;
+        Uint32 codepoint;
+
+        bool operator==(const GlyphKey& o) const {
+            return fontSize == o.fontSize && codepoint == o.codepoint;
+        }
+    };
+
+    struct GlyphKeyHash {
+        size_t operator()(const GlyphKey& k) const {
+            return static_cast<size_t>((static_cast<uint64_t>(k.fontSize) << 32) ^ k.codepoint) * 1099511628211ull;
+        }
+    };
+
+    struct Glyph {
+        int page;           // -1 for glyphs without pixels (spaces)
+        SDL_Rect rect;      // Position inside of the page
+        int offsetX;        // Left edge of the pixels, relative to the pen
+        int offsetY;        // Top edge of the pixels, relative to the top of the line
+        int advance;
+        bool baked = false; // Loaded from the baked file, its kerning pairs are in kerning
+    };
+
+    struct Page {
+        SDL_Texture* texture;   // nullptr while a loaded page waits for upload
+        int shelfX, shelfY, shelfHeight;
+    };
+
+    static inline bool enabled = true;
+
+    static inline int PAGE_SIZE = 1024;
+    static inline int MAX_PAGES = 4;
+
+    static inline vector<Page> pages;
+    static inline unordered_map<GlyphKey, Glyph, GlyphKeyHash> glyphs;
+    static inline Uint64 generation = 0;   // Increased on every reset
+
+    // Reused by draw() and drawRun(), so drawing doesn't allocate
+    static inline vector<const Glyph*> line;
+    static inline vector<int> penX;
+    static inline vector<SDL_Vertex> scratchVertices;
+    static inline vector<int> scratchIndices;
+
+    // BAKED, see GlyphAtlas::load
+    // Kerning of the baked sizes, so the layout doesn't need FreeType either
+    static inline Sys::MappedFile baked = {nullptr, 0, false};
+    // Pixels of every page in baked, only usedHeight rows (checked by load)
+    struct BakedPixels {
+        size_t offset;
+        int usedHeight;
+    };
+    static inline vector<BakedPixels> bakedPixels;
+    static inline set<int> bakedSizes;
+    static inline unordered_map<uint64_t, int> kerning;
+
+    static const Glyph* getGlyph(TTF_Font* font, int fontSize, Uint32 codepoint);
+    static bool allocate(int w, int h, int& page, SDL_Rect& out);
+    static void reset();
+
+    // Renders the glyph in white, trimmed to the pixels with some coverage.
+    // pixels get w * h tightly packed RGBA32 pixels, w is 0 if there are none
+    static void rasterize(TTF_Font* font, Uint32 codepoint, Glyph& glyph, vector<Uint8>& pixels, int& w, int& h);
+
+    // Shelf packing, shared by the pages and by bake
+    static bool pack(Page& page, int w, int h, SDL_Rect& out);
+
+    static int getKerning(TTF_Font* font, int fontSize, Uint32 left, Uint32 right);
+    static void uploadBaked();
+
+    // Quads of the glyphs in line at penX, into DrawList
+    static void emitQuads(float x, float y, float sx, float sy, const SDL_Color& color);
+};
+
+
+
+/**
+ * @brief TextBuffer, the text of a GUI::TextArea as a piece table.
+ *
+ * The text is never moved around. The loaded text sits in `original`,
+ * everything typed is appended to `added`, and the document is a list
+ * of pieces pointing into those two. An edit splits a piece or two and
+ * inserts/removes pieces, so it costs the size of the edit plus the
+ * number of pieces, not the size of the document. Typing at the same
+ * spot keeps growing the same piece.
+ *
+ * LINE INDEX. The positions of the '\n' of both buffers are kept sorted,
+ * every piece counts its lines with a binary search in them, so going
+ * from a line to its position (and back) doesn't walk the text either.
+ *
+ * All positions are in bytes (UTF-8).
+ */
+class TextBuffer {
+public:
+    TextBuffer(const string& text = "");
+
+    /** @brief Replaces the whole text. */
+    void assign(const string& text);
+
+    void insert(size_t pos, const string& text);
+    void erase(size_t pos, size_t length);
+
+    size_t size() const { return total; }
+    size_t lineCount() const { return totalLines + 1; }
+
+    /** @brief Position of the first byte of the line. */
+    size_t lineStart(size_t line) const;
+
+    /** @brief Length of the line, without its '\n'. */
+    size_t lineLength(size_t line) const;
+
+    /** @brief Line that the byte at pos is in. */
+    size_t lineOf(size_t pos) const;
+
+    char at(size_t pos) const;
+    void getText(size_t pos, size_t length, string& out) const;
+    void getLine(size_t line, string& out) const;
+    string toString() const;
+
+private:
+    struct Piece {
+        bool added;         // Which buffer, added or original
+        size_t start;
+        size_t length;
+        size_t lines;       // '\n' inside of the piece
+    };
+
+    string original;
+    string added;
+    vector<size_t> originalLines;   // Positions of the '\n' in original
+    vector<size_t> addedLines;      // and in added
+
+    vector<Piece> pieces;
+    vector<size_t> pieceStart;      // Position of every piece in the document
+    vector<size_t> linesBefore;     // '\n' before every piece
+    size_t total = 0;
+    size_t totalLines = 0;
+
+    const string& buffer(const Piece& p) const { return p.added ? added : original; }
+    const vector<size_t>& bufferLines(const Piece& p) const { return p.added ? addedLines : originalLines; }
+
+    size_t countLines(const Piece& p, size_t start, size_t length) const;
+    size_t findPiece(size_t pos) const;
+
+    // Makes a piece start at pos, returns its index (pieces.size() at the end)
+    size_t split(size_t pos);
+    void reindex();
+};
+
+
+
 class GUI{
     friend class Sys;
 
@@ -93,65 +804,162 @@ class GUI{
         int thickness
     );
 
+public:
+    /**
+     * @brief Size of a text rendered with the Lumos font.
+     *
+     * width, height - size of the rendered text, TTF_GetStringSize
+     * ascent        - from the top of the line to the baseline
+     * lineHeight    - TTF_GetFontHeight of the size it was measured at
+     */
+    struct TextMetrics {
+        int width;
+        int height;
+        int ascent;
+        int lineHeight;
+    };
+
 private:
     /**
      * @brief LoadedText structure, used to store some commonly re-used texts
      * 
      * Insted of recompiling text textures every single frame they are stored
-     * in a unordered_map<LoadedText> which has max capacity of MAX_LOADED_TEXTS 
+     * in loadedTexts, keyed by a 64 bit hash of the title and fontSize.
+     * Different texts can end up with the same hash, so every entry keeps its
+     * title and fontSize and those are compared on lookup.
      * 
-     * Whenever user requests to render a text, first the GUI::Text function
-     * checks if there are any pre-loaded, pre-used, text textures matching
-     * the requested text, using the textID, which is calculated with title, 
-     * fontSize and color of the text. 
+     * The textures are white, the color is applied when drawing (vertex
+     * color modulation), so one texture serves every color of the text.
      * 
-     * If there are no matching ids, the new LoadedText object is pushed into 
-     * the unordered map.
+     * All of the entries are also linked into a LRU list, the most recently
+     * used one at the front. Using a text moves it to the front, so the least
+     * used one is always at the back and removing it is O(1).
      * 
-     * If the unordered map has length greater then MAX_LOADED_TEXTS, 
-     * the texture that was the least used gets removed. 
+     * The cache is limited by whichever is hit first:
+     *  - MAX_LOADED_TEXTS, number of texts (setMaxNumOfLoadedTextures)
+     *  - textCacheBudget, bytes of the textures (setTextCacheBudget)
      * 
-     * To determene which one is the least used, library
-     * looks at lastUsedFrame variable. The olderst is deleted.
+     * Optionally, texts that weren't used for textCacheMaxAge frames are
+     * removed at the end of the frame (setTextCacheMaxAge).
      */
     struct LoadedText {
         TextureData td;     // Holds the Compiled Text Texture
         string title;       // The text
         int fontSize;       // The fontSize used
-        SDL_Color color;    // The color of text
         int lastUsedFrame;  // Last frame that this texture was used
+        bool pending;       // Async text only, still being rasterized, td is empty
 
-        // Defualt Initializor
-        LoadedText(
-            TextureData _td = TextureData(),
-            string _title = "",
-            int _fontSize = 0,
-            SDL_Color _color = SDL_COLOR_WHITE,
-            int _lastUsedFrame = 0
-        ):
-            td(_td),
-            title(_title),
-            fontSize(_fontSize),
-            color(_color),
-            lastUsedFrame(_lastUsedFrame) {};
-
-        // Calculate the TextID
-        string getId() { return getTextId(title, fontSize, color); }
-
-        // Comparator: sort by value
-        bool operator<(const LoadedText& other) const { return lastUsedFrame < other.lastUsedFrame; }
-        bool operator>(const LoadedText& other) const { return lastUsedFrame > other.lastUsedFrame; }
+        uint64_t hash;          // Key in loadedTexts
+        size_t bytes;           // Size of the texture, counted against textCacheBudget
+        LoadedText* lruPrev;    // Used more recently
+        LoadedText* lruNext;    // Used less recently
     };
 
-    // Unordered Map for storing Loaded Texts
-    // Key is text id, obtained from getTextId() or LoadedText.getId()
-    static inline unordered_map<string, LoadedText> loadedTexts;
-    static inline int MAX_LOADED_TEXTS = 0; // 0 means unlimited
+    // Key is hashText(title, fontSize), collisions share the key
+    static inline unordered_multimap<uint64_t, unique_ptr<LoadedText>> loadedTexts;
+    static inline LoadedText* lruFront = nullptr;   // Most recently used
+    static inline LoadedText* lruBack = nullptr;    // Least recently used
 
-    static string getTextId(const string& title, int fontSize, SDL_Color color);
-    static LoadedText* loadNewText(string title, int fontSize, SDL_Color color);
+    static inline int MAX_LOADED_TEXTS = 0;         // 0 means unlimited
+    static inline size_t textCacheBudget = 0;       // Bytes, 0 means unlimited
+    static inline size_t textCacheBytes = 0;        // Bytes currently loaded
+    static inline int textCacheMaxAge = 0;          // Frames, 0 means never sweep
+
+    static uint64_t hashText(const string& title, int fontSize);
+
+    /**
+     * @brief Returns the cached text, loading it if it isn't cached yet.
+     * Also marks it as used in this frame. With async text the returned
+     * text can still be pending.
+     */
+    static LoadedText* getText(const string& title, int fontSize);
+    static LoadedText* findText(uint64_t hash, const string& title, int fontSize);
+
+    static LoadedText* loadNewText(const string& title, int fontSize);
+    static void removeText(LoadedText* text);
     static void removeOldestText();
 
+    // Removes texts older then textCacheMaxAge and old dynamic text ids,
+    // called by Sys::presentFrame
+    static void sweepTexts();
+
+    // Cache of measureText, key is hashMix(hashBytes(text), fontSize).
+    // Over MAX_TEXT_METRICS the least recently used entry is removed,
+    // same as loadedTexts.
+    struct CachedMetrics {
+        string text;
+        int fontSize;
+        TextMetrics metrics;
+
+        uint64_t hash;              // Key in textMetrics
+        CachedMetrics* lruPrev;     // Used more recently
+        CachedMetrics* lruNext;     // Used less recently
+    };
+    static inline unordered_multimap<uint64_t, unique_ptr<CachedMetrics>> textMetrics;
+    static inline CachedMetrics* metricsFront = nullptr;
+    static inline CachedMetrics* metricsBack = nullptr;
+    static inline size_t MAX_TEXT_METRICS = 8192;
+
+    // Font size calcTextHeight measures at, the result is scaled from there
+    static inline int METRICS_REFERENCE_SIZE = 64;
+
+    // Pass nullptr as font to get it from Sys::getFont, only if it's not cached
+    static TextMetrics measureTextWith(TTF_Font* font, const string& text, int fontSize);
+    static void clearTextMetrics();
+
+    // TEXT DYNAMIC, one streaming texture per id. The texture is bigger then
+    // needed (headroom), only the width x height part of it holds the text
+    struct DynamicText {
+        SDL_Texture* texture;   // White text, tinted when drawn
+        int width, height;      // Part of the texture used by the text
+
+        string title;           // What's in the texture right now
+        int fontSize;
+        int lastUsedFrame;      // Ids not drawn for DYNAMIC_TEXT_MAX_AGE frames are removed
+    };
+    static inline unordered_map<string, DynamicText> dynamicTexts;
+    static inline int DYNAMIC_TEXT_MAX_AGE = 600;
+
+    // Renders the text into the texture of the id, swapping it for another one if needed
+    static bool updateDynamicText(DynamicText& dt, const string& title, int fontSize);
+
+    // Removes the ids that weren't drawn for a while, called by sweepTexts
+    static void sweepDynamicTexts();
+
+    // ASYNC TEXT, see GUI::setAsyncText
+    // The workers are started with the first job and stopped
+    // by Sys::closeFonts, as their fonts are opened from Sys::fontFile
+    struct TextJob {
+        string title;
+        int fontSize;
+        SDL_Surface* surface;   // Result, nullptr if rendering failed
+    };
+
+    static inline bool asyncText = false;
+    static inline int asyncTextWorkers = 2;
+    static inline Uint64 textUploadBudgetNS = 2000000;      // 2ms
+
+    static inline vector<std::thread> textWorkers;
+    static inline std::mutex textJobsMutex;                 // Guards textJobs, textResults and stopTextWorkers
+    static inline std::condition_variable textJobsCV;
+    static inline std::deque<TextJob> textJobs;
+    static inline vector<TextJob> textResults;
+    static inline bool stopTextWorkers = false;
+
+    static void queueText(LoadedText* text);
+    static void textWorker();
+
+    // Uploads the finished texts, called by Sys::handleEvents
+    static void uploadTexts();
+    static void stopAsyncText();
+
+    /**
+     * @brief Draws the text trough the GlyphAtlas, taking care of the
+     * active container (offset, scroll and clipping).
+     * @return false if the GlyphAtlas can't draw it, use the text textures then
+     */
+    static bool drawGlyphText(const string& text, int fontSize, const SDL_Rect& dRect, const SDL_Color& color);
+
 
 
 
@@ -186,9 +994,14 @@ private:
                                 // its true, so the texture would get compiled the first Frame
         
         bool deleting = false;  // Used to check if the backspace has been down
+        Uint64 deleteAt = 0;    // SDL_GetTicks of the next deletion while its held
         
-        int removed = 0;    // Keeps the track of how many character need to be cut 
-                            // from the left, so the text can be fit inside the field
+        // GLYPH RUN, see GlyphAtlas::layout. Only the typed chars are added,
+        // the whole value is laid out again only when the size changes
+        vector<Uint32> glyphs;      // Codepoints of the value
+        vector<int> carets;         // Pen after every codepoint, carets.back() is the width
+        int layoutSize = 0;         // fontSize of the layout, 0 means lay it out again
+        float layoutScale = 1.f;    // From the font pixels to the screen
         
         
         // Default Constructor
@@ -209,6 +1022,69 @@ private:
     // Key is InputState.id
     static inline unordered_map<string, InputState> inputStates;
 
+    /**
+     * @brief Draws the vissible part of a glyph run (GlyphAtlas::layout)
+     * into textRect, the scrollX pixels on the left are cut off. Takes care
+     * of the active container, like GUI::Image.
+     * @return false if the GlyphAtlas can't draw it, use a texture then
+     */
+    static bool drawGlyphRun(
+        const vector<Uint32>& glyphs,
+        const vector<int>& carets,
+        int fontSize,
+        float scale,
+        const SDL_Rect& textRect,
+        int scrollX,
+        const SDL_Color& color
+    );
+
+
+
+    /**
+     * @brief TextAreaState, the state of a single GUI::TextArea. Same as
+     * InputState it stays until GUI::DestroyTextArea.
+     *
+     * Only the lines on screen get laid out, their glyph runs are kept in
+     * `lines` by line number. An edit drops the line it was in, and if
+     * it adds or removes lines, all of the ones after it too.
+     */
+    struct TextAreaState {
+        struct Line {
+            string text;
+            vector<Uint32> glyphs;
+            vector<int> carets;
+            int lastUsedFrame;
+        };
+
+        string id;
+        TextBuffer text;
+        size_t cursor = 0;          // Byte position of the caret
+        bool focused = false;
+        bool followCursor = false;  // Scroll to the caret with the next frame
+
+        int scrollX = 0;
+        int layoutSize = 0;         // fontSize of the lines, 0 means lay them out again
+        float layoutScale = 1.f;
+        unordered_map<size_t, Line> lines;
+
+        // Held keys repeat, see TextArea.cpp
+        SDL_Scancode repeatKey = SDL_SCANCODE_UNKNOWN;
+        Uint64 repeatAt = 0;
+
+        TextAreaState(const string& _id): id(_id) {};
+    };
+
+    static inline unordered_map<string, TextAreaState> textAreaStates;
+
+    static TextAreaState::Line* getTextAreaLine(TextAreaState* state, size_t line);
+    static void editTextArea(TextAreaState* state, size_t pos, size_t eraseLength, const string& insert);
+
+    // Pen x of the caret at pos, in font pixels (not scaled)
+    static int textAreaCaretX(TextAreaState* state, size_t pos);
+
+    // Position of the char in line closest to the pen x
+    static size_t textAreaPosAt(TextAreaState* state, size_t line, int x);
+
 
 
 
@@ -260,6 +1136,82 @@ private:
     );
 
 
+    /**
+     * @brief BakedShape, a rect pre-rendered into its own texture.
+     *
+     * Most rects are drawn directly onto the current render target
+     * using geometry. The only ones that can't are semi-transparent
+     * dashed outlines, their dash segments and corner fillers overlap
+     * so drawing them directly would blend the overlaps twice.
+     *
+     * Those are rendered once into a texture in opaque white, where
+     * the overlaps don't matter, and the texture uses premultiplied
+     * blending. It's drawn tinted with the premultiplied color, so the
+     * alpha is applied exactly once. The color isn't part of the key,
+     * one texture serves every color.
+     *
+     * The map has max capacity of MAX_BAKED_SHAPES, when its full the
+     * least recently used shape (back of the LRU list) gets removed.
+     */
+    struct BakedShapeKey {
+        int w, h;
+        int thickness;
+        BorderRadiusRect radius;
+        int dashSize;
+        int dashGapSize;
+
+        bool operator==(const BakedShapeKey& o) const {
+            return w == o.w && h == o.h &&
+                   thickness == o.thickness &&
+                   radius.top_left == o.radius.top_left &&
+                   radius.top_right == o.radius.top_right &&
+                   radius.bottom_left == o.radius.bottom_left &&
+                   radius.bottom_right == o.radius.bottom_right &&
+                   dashSize == o.dashSize && dashGapSize == o.dashGapSize;
+        }
+    };
+
+    struct BakedShapeKeyHash {
+        size_t operator()(const BakedShapeKey& k) const {
+            uint64_t h = hashMix(FNV_OFFSET, uint64_t(k.w));
+            h = hashMix(h, uint64_t(k.h));
+            h = hashMix(h, uint64_t(k.thickness));
+            h = hashMix(h, k.radius.top_left);
+            h = hashMix(h, k.radius.top_right);
+            h = hashMix(h, k.radius.bottom_left);
+            h = hashMix(h, k.radius.bottom_right);
+            h = hashMix(h, uint64_t(k.dashSize));
+            h = hashMix(h, uint64_t(k.dashGapSize));
+            return static_cast<size_t>(h);
+        }
+    };
+
+    struct BakedShape {
+        TextureData td;         // Holds the pre-rendered shape, white
+        BakedShapeKey key;      // Key in bakedShapes
+        BakedShape* lruPrev;    // Used more recently
+        BakedShape* lruNext;    // Used less recently
+    };
+
+    static inline unordered_map<BakedShapeKey, BakedShape, BakedShapeKeyHash> bakedShapes;
+    static inline BakedShape* bakedFront = nullptr;     // Most recently used
+    static inline BakedShape* bakedBack = nullptr;      // Least recently used
+    static inline int MAX_BAKED_SHAPES = 64;
+
+    /**
+     * @brief Internal helper function called by GUI::Rect for shapes
+     * that have to be baked, it finds (or creates) the baked texture
+     * and renders it at the dRect, clipped to clipRect if its set.
+     */
+    static void renderBakedRect(
+        const SDL_Rect& dRect,
+        const SDL_Color& color,
+        const int thickness,
+        const BorderRadiusRect& borderRadius,
+        const SDL_Rect* clipRect = nullptr
+    );
+
+
 
 
 
@@ -332,6 +1284,51 @@ public:
         const SDL_Color& color
     );
 
+    /** Text Dynamic, with an id
+     * 
+     * Same as the one above, but the call site (id) keeps its own streaming
+     * texture, so texts like FPS counters and clocks don't create and destroy
+     * a texture every frame. The new text is written into the same texture
+     * and it's only reallocated when the text outgrows it. If the old text
+     * was already drawn in this frame it gets another (pooled) texture, so
+     * the batched commands keep the old one. Nothing at all is rendered
+     * while the text stays the same.
+     * 
+     * Use a different id for every place the text is shown at, if one id is
+     * drawn multiple times in a frame with different texts, the last one wins.
+     * 
+     * @param id Unique id of the call site, eg. "fps-counter"
+     * @param title Text to be rendered.
+     * @param dRect Same as in GUI::Text
+     * @param color The color of the text
+     */
+    static void TextDynamic(
+        const string& id,
+        const string& title, 
+        SDL_Rect& dRect, 
+        const SDL_Color& color
+    );
+
+    /**
+     * @brief Frees the texture of a TextDynamic id. Ids that aren't drawn
+     * for a while (DYNAMIC_TEXT_MAX_AGE frames) are freed anyway, this is
+     * for ones that are known to be gone, eg. when a screen is closed.
+     */
+    static void DestroyTextDynamic(const string& id);
+
+    /**
+     * @brief Measures the text at fontSize. Results are cached by
+     * (text, fontSize), so measuring the same label every frame is cheap.
+     */
+    static TextMetrics measureText(const string& text, int fontSize);
+
+    /**
+     * @brief Measures all of the texts at fontSize in one pass,
+     * out[i] are the metrics of texts[i]. Handy for laying out
+     * hundreds of labels at once.
+     */
+    static void measureTexts(const vector<string>& texts, int fontSize, vector<TextMetrics>& out);
+
     /**
      * @brief Calculates the Width of the text using its aspect ratio.
      * 
@@ -352,6 +1349,33 @@ public:
 
     static void setMaxNumOfLoadedTextures(int number = 0);
 
+    /**
+     * @brief Limits the cached text textures by their size in bytes,
+     * the least recently used are removed first. 0 means unlimited.
+     */
+    static void setTextCacheBudget(size_t bytes = 0);
+
+    /**
+     * @brief Cached texts that weren't drawn in the last `frames` frames
+     * get removed at the end of the frame. 0 turns it off.
+     */
+    static void setTextCacheMaxAge(int frames = 0);
+
+    /**
+     * @brief Async text, for screens that show a lot of new texts at once.
+     *
+     * When it's on, a text that isn't in the text cache yet is rendered
+     * on one of `workers` background threads (each with its own fonts)
+     * insted of on the main thread, and the widget draws nothing until
+     * it's done. Finished texts are turned into textures at the start
+     * of the next frame, for at most `uploadBudgetUs` microseconds per
+     * frame, the rest waits for the following frames.
+     *
+     * Only the cached text textures are affected, the GlyphAtlas renders
+     * its glyphs on the main thread (every glyph only once anyway).
+     */
+    static void setAsyncText(bool enabled = true, int workers = 2, int uploadBudgetUs = 2000);
+
 
     /** GUI Button
      * 
@@ -398,6 +1422,23 @@ public:
         SDL_Rect& rect
     );
 
+    /** GUI Image
+     * 
+     * Renders only the srcRect part of the SDL_Texture*,
+     * like SDL_RenderTexture. nullptr means the whole texture.
+     * 
+     * @param texture SDL_Texture*, texture to be rendered
+     * @param srcRect Part of the texture, in pixels
+     * @param dRect Destination Rectangle: x, y, width, height
+     * @param tint Multiplies the colors of the texture, white keeps them
+    */
+    static void Image(
+        SDL_Texture* texture,
+        const SDL_Rect* srcRect,
+        SDL_Rect& rect,
+        const SDL_Color& tint = SDL_COLOR_WHITE
+    );
+
     /** GUI Image
      * 
      * This function renders a TextureData.
@@ -473,6 +1514,42 @@ public:
     static InputState* getInputState(const string& inputId);
 
 
+    /**
+     * @brief Renders a multi-line text editor, made for big texts like
+     * config and log files. The text is a TextBuffer (piece table), so an
+     * edit costs as much as the edit, and only the lines inside of the
+     * view are drawn. It scrolls like a container, so it can't be put
+     * into one.
+     *
+     * Keys: typing, Enter, Backspace, Delete, arrows, Home and End.
+     *
+     * Styling options supported:
+     * - `pushFontSize` (line height, 16 by default)
+     * - `pushPadding`
+     *
+     * @param uniqueId A unique string used to identify the field across frames.
+     * @param dRect Position and size of the field.
+     * @param background Background color, white by default.
+     * @param textColor Color of the text, black by default.
+     * @return true if the text was changed this frame
+     */
+    static bool TextArea(
+        const string& uniqueId,
+        const SDL_Rect& dRect,
+        const SDL_Color& background = SDL_COLOR_WHITE,
+        const SDL_Color& textColor = SDL_COLOR_BLACK
+    );
+
+    /** @brief Replaces the text of a TextArea, creating its state if needed. */
+    static void setTextAreaValue(const string& uniqueId, const string& text);
+
+    /** @brief The TextBuffer of a TextArea, nullptr if it doesn't exist. */
+    static const TextBuffer* getTextAreaValue(const string& uniqueId);
+
+    /** @brief Destroys the state of a TextArea, like DestroyInput. */
+    static void DestroyTextArea(const string& uniqueId);
+
+
     /** GUI Container
      * @brief Creates a scrollable Container
      * All of the coordinates are rest to (0, 0) meaning
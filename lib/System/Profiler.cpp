@@ -0,0 +1,141 @@
+#include "Sys.h"
+#include <fstream>
+
+
+
+Profiler::ThreadBuffer& Profiler::localBuffer(){
+    thread_local ThreadBuffer* buffer = nullptr;
+    if(buffer != nullptr) return *buffer;
+
+    // First zone on this thread, register its buffer
+    std::lock_guard<std::mutex> lock(buffersMutex);
+
+    auto b = make_unique<ThreadBuffer>();
+    b->tid = static_cast<int>(buffers.size()) + 1;
+    b->name = Sys::isMainThread() ? "Main" : "Thread " + to_string(b->tid);
+
+    buffer = b.get();
+    buffers.push_back(std::move(b));
+    return *buffer;
+}
+
+
+
+void Profiler::record(const char* name, Uint64 startNS, Uint64 endNS){
+    ThreadBuffer& b = localBuffer();
+
+    // Only this thread writes the head, the release makes the event
+    // visible to the thread that writes the trace
+    Uint64 head = b.head.load(std::memory_order_relaxed);
+    b.events[head & (BUFFER_EVENTS - 1)] = { name, startNS, endNS };
+    b.head.store(head + 1, std::memory_order_release);
+}
+
+
+
+void Profiler::frameMark(Uint64 ns){
+    frameMarks[frameMarksCount % FRAME_MARKS] = ns;
+    frameMarksCount++;
+}
+
+
+
+void Profiler::setThreadName(const string& name){
+    ThreadBuffer& b = localBuffer();
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    b.name = name;
+}
+
+
+
+// Names are mostly literals, but make sure they can't break the JSON
+static void writeJsonString(std::ofstream& out, const char* s){
+    out << '"';
+    for(; *s; s++){
+        if(*s == '"' || *s == '\\') out << '\\' << *s;
+        else if(static_cast<unsigned char>(*s) < 0x20) out << ' ';
+        else out << *s;
+    }
+    out << '"';
+}
+
+// Chrome trace times are in microseconds
+static void writeEvent(std::ofstream& out, const char* name, Uint64 start, Uint64 end, int tid){
+    char times[96];
+    snprintf(times, sizeof(times), "\"ts\":%.3f,\"dur\":%.3f", start / 1000.0, (end - start) / 1000.0);
+
+    out << ",\n{\"name\":";
+    writeJsonString(out, name);
+    out << ",\"cat\":\"lumos\",\"ph\":\"X\"," << times << ",\"pid\":1,\"tid\":" << tid << "}";
+}
+
+static void writeThreadName(std::ofstream& out, int tid, const char* name){
+    out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid << ",\"args\":{\"name\":";
+    writeJsonString(out, name);
+    out << "}}";
+}
+
+
+
+int Profiler::writeTrace(const string& path, int frames){
+    frames = std::clamp(frames, 1, FRAME_MARKS - 1);
+
+    // Everything that started before the oldest wanted frame is skipped
+    Uint64 marks = std::min<Uint64>(frameMarksCount, FRAME_MARKS);
+    Uint64 wanted = std::min<Uint64>(marks, frames);
+    Uint64 firstMark = frameMarksCount - wanted;
+    Uint64 cutoff = (wanted > 0) ? frameMarks[firstMark % FRAME_MARKS] : 0;
+
+    std::ofstream out(path);
+    if(!out.is_open()) return SYS_TRACE_WRITE_ERROR;
+
+    // The first entry has no comma in front, every other one does
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    out << "\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Lumos\"}}";
+    writeThreadName(out, 0, "Frames");
+    Uint64 written = 0;
+
+    // FRAMES, on their own track ---------------------------------------------
+    Uint64 now = SDL_GetTicksNS();
+    for(Uint64 i = firstMark; i < frameMarksCount; i++){
+        Uint64 start = frameMarks[i % FRAME_MARKS];
+        Uint64 end = (i + 1 < frameMarksCount) ? frameMarks[(i + 1) % FRAME_MARKS] : now;
+        writeEvent(out, "Frame", start, end, 0);
+    }
+
+    // ZONES OF EVERY THREAD --------------------------------------------------
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    vector<Event> events;
+
+    for(const auto& b : buffers){
+        // Copy the events out first, the owner keeps on writing meanwhile
+        Uint64 head = b->head.load(std::memory_order_acquire);
+        Uint64 from = (head > BUFFER_EVENTS) ? head - BUFFER_EVENTS : 0;
+
+        events.clear();
+        events.reserve(head - from);
+        for(Uint64 i = from; i < head; i++) events.push_back(b->events[i & (BUFFER_EVENTS - 1)]);
+
+        // Anything the owner could have overwritten during the copy is dropped
+        Uint64 newHead = b->head.load(std::memory_order_acquire);
+        Uint64 safeFrom = (newHead >= BUFFER_EVENTS) ? newHead - BUFFER_EVENTS + 1 : 0;
+        Uint64 skip = (safeFrom > from) ? std::min<Uint64>(safeFrom - from, events.size()) : 0;
+
+        for(size_t i = skip; i < events.size(); i++){
+            const Event& e = events[i];
+            if(e.start < cutoff) continue;
+
+            writeEvent(out, e.name, e.start, e.end, b->tid);
+            written++;
+        }
+
+        writeThreadName(out, b->tid, b->name.c_str());
+    }
+
+    out << "\n]}\n";
+
+    if(!out.good()) return SYS_TRACE_WRITE_ERROR;
+
+    if(written == 0) Sys::printf_warn("dumpTrace: no profiling zones were recorded, is Lumos built with LUMOS_PROFILE?");
+    return NO_ERROR;
+}
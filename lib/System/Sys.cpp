@@ -1,6 +1,13 @@
 #include "Sys.h"
 #include "../GUI/gui.h"
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 
 unordered_map<int, string> Sys::errorMap = {
     {NO_ERROR,                          "NO_ERROR"},
@@ -13,6 +20,10 @@ unordered_map<int, string> Sys::errorMap = {
     {SYS_FPS_TOO_LOW,                   "SYS_FPS_TOO_LOW"},
     {SYS_FPS_TOO_HIGH,                  "SYS_FPS_TOO_HIGH"},
     {SYS_FONT_NOT_INITED,               "SYS_FONT_NOT_INITED"},
+    {SYS_VSYNC_ERROR,                   "SYS_VSYNC_ERROR"},
+    {SYS_TRACE_WRITE_ERROR,             "SYS_TRACE_WRITE_ERROR"},
+    {SYS_GLYPH_ATLAS_IO_ERROR,          "SYS_GLYPH_ATLAS_IO_ERROR"},
+    {SYS_GLYPH_ATLAS_INVALID,           "SYS_GLYPH_ATLAS_INVALID"},
 
     {TM_SURFACE_CREATE_ERROR,           "TM_SURFACE_CREATE_ERROR"},
     {TM_SURFACE_CONVERT_ERROR,          "TM_SURFACE_CONVERT_ERROR"},
@@ -84,6 +95,9 @@ int Sys::initWindow(
         return SYS_SDL_INIT_ERROR;
     }
 
+    // Event used by Sys::requestWakeUp to wake the main thread from other threads
+    wakeUpEvent = SDL_RegisterEvents(1);
+
 
     // CREATE WINDOW ------------------------------------------------------
     flags = SDL_WINDOW_RESIZABLE  |
@@ -107,8 +121,10 @@ int Sys::initWindow(
 
 
     // CREATE RENDERER -----------------------------------------------------
+    // SDL_HINT_RENDER_DRIVER (or the SDL_RENDER_DRIVER env variable) can force a backend
     const string backends = "gpu,vulkan,opengl,opengles2,software";
-    r = SDL_CreateRenderer(win, backends.c_str());
+    const char* forced = SDL_GetHint(SDL_HINT_RENDER_DRIVER);
+    r = SDL_CreateRenderer(win, (forced && *forced) ? forced : backends.c_str());
 
     if(!r){
         cout << "[FATAL] Failed to create rederer!" << endl;
@@ -141,7 +157,7 @@ int Sys::initWindow(
  * 
  * @return 0 on success and positive on error, coresponding to ERROR DEFINITIONS
  */
-int Sys::initFont(const string& fontPath){
+int Sys::initFont(const string& fontPath, const string& glyphAtlasPath){
     // FONT INIT ---------------------------------------------------------
     int status = TTF_Init();
     if(!status){
@@ -154,25 +170,191 @@ int Sys::initFont(const string& fontPath){
         return SYS_FONT_INIT_ERROR;
     }
 
+    // A different font, everything opened or measured with the old one goes
+    closeFonts();
+    GUI::clearTextMetrics();
+    GlyphAtlas::clear();
+
+    // MAP THE FILE --------------------------------------------------------
+    // Read once, every size is parsed from this memory insted of the disk
+    if(!mapFile(fontPath, fontFile)){
+        cout << "[FATAL] Failed to initialize fonts! Can't read the font file." << endl;
+        return SYS_FONT_INIT_ERROR;
+    }
+    fontHash = hashBytes(fontFile.data, fontFile.size);
+
     Sys::fontPath = fontPath;
 
+    // PREBAKED GLYPHS -----------------------------------------------------
+    if(!glyphAtlasPath.empty()){
+        int err = GlyphAtlas::load(glyphAtlasPath);
+        if(err != NO_ERROR) printf_warn("Glyph atlas " + glyphAtlasPath + " not loaded: " + checkError(err));
+    }
+
     cout << "[INIT] Fonts Initialized..." << endl;
     return NO_ERROR;
 }
 
 
-TTF_Font* Sys::getFont(const int& fontSize){
-    TTF_Font* font = nullptr;
-    if(Sys::fontMap.count(fontSize)){
-        font = Sys::fontMap[fontSize];
-    } else {
-        font = TTF_OpenFont(Sys::fontPath.c_str(), fontSize);
-        if(font == nullptr){
-            cout << "[FATAL] Failed to load font!" << endl;
-            return nullptr;
+
+bool Sys::mapFile(const string& path, MappedFile& file){
+    file = {nullptr, 0, false};
+
+#ifndef _WIN32
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if(fd != -1 && fstat(fd, &st) == 0 && st.st_size > 0){
+        void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(data != MAP_FAILED) file = {data, size_t(st.st_size), true};
+    }
+    if(fd != -1) close(fd);
+#endif
+
+    if(file.data == nullptr){
+        size_t size = 0;
+        void* data = SDL_LoadFile(path.c_str(), &size);
+        if(data == nullptr) return false;
+        file = {data, size, false};
+    }
+
+    return true;
+}
+
+
+
+void Sys::unmapFile(MappedFile& file){
+    if(file.data != nullptr){
+#ifndef _WIN32
+        if(file.mapped) munmap(const_cast<void*>(file.data), file.size);
+        else SDL_free(const_cast<void*>(file.data));
+#else
+        SDL_free(const_cast<void*>(file.data));
+#endif
+    }
+    file = {nullptr, 0, false};
+}
+
+
+
+TTF_Font* Sys::openFont(int fontSize){
+    if(fontFile.data == nullptr) return nullptr;
+
+    // Every size gets its own stream over the same memory, closed with the font
+    SDL_IOStream* io = SDL_IOFromConstMem(fontFile.data, fontFile.size);
+    if(io == nullptr) return nullptr;
+
+    std::lock_guard<std::mutex> lock(faceMutex);
+    return TTF_OpenFontIO(io, true, static_cast<float>(fontSize));
+}
+
+
+
+void Sys::closeFont(TTF_Font* font){
+    if(font == nullptr) return;
+
+    std::lock_guard<std::mutex> lock(faceMutex);
+    TTF_CloseFont(font);
+}
+
+
+
+void Sys::closeFonts(){
+    // Everything that uses fontFile has to stop first
+    GUI::stopAsyncText();
+
+    if(prewarmThread.joinable()){
+        stopPrewarm = true;
+        prewarmThread.join();
+        stopPrewarm = false;
+    }
+
+    for(auto& [size, f] : fontMap) closeFont(f.font);
+    fontMap.clear();
+
+    unmapFile(fontFile);
+    fontHash = 0;
+}
+
+
+
+int Sys::prewarmFonts(const vector<int>& sizes, const string& glyphs){
+    if(fontFile.data == nullptr) return SYS_FONT_NOT_INITED;
+
+    // Only one at a time, wait for the previous one
+    if(prewarmThread.joinable()) prewarmThread.join();
+
+    prewarmThread = std::thread(prewarm, sizes, glyphs);
+    return NO_ERROR;
+}
+
+
+
+void Sys::prewarm(vector<int> sizes, string glyphs){
+    PROFILE_THREAD("Font prewarm");
+
+    for(int size : sizes){
+        if(stopPrewarm) return;
+        PROFILE_ZONE("Sys::prewarm");
+
+        {
+            std::lock_guard<std::mutex> lock(fontMutex);
+            if(fontMap.count(size)) continue;
+        }
+
+        // Opened and used only by this thread until it's handed over.
+        // Opening and closing take faceMutex, the main thread might be doing the same
+        TTF_Font* font = openFont(size);
+        if(font == nullptr) continue;
+
+        // Rendering fills the glyph cache of the font
+        const char* p = glyphs.c_str();
+        size_t left = glyphs.size();
+        while(left > 0 && !stopPrewarm){
+            Uint32 cp = SDL_StepUTF8(&p, &left);
+            if(cp == 0) break;
+
+            SDL_Surface* s = TTF_RenderGlyph_Blended(font, cp, SDL_COLOR_WHITE);
+            if(s) SDL_DestroySurface(s);
         }
-        Sys::fontMap.insert({fontSize, font});
+
+        // Hand it over, unless the main thread opened this size meanwhile.
+        // Never evicts, the main thread might be using the fonts in the map
+        std::lock_guard<std::mutex> lock(fontMutex);
+        if(fontMap.count(size) || fontMap.size() >= MAX_OPEN_FONTS){
+            closeFont(font);
+            continue;
+        }
+        fontMap.insert({size, {font, fontUseTick}});
+    }
+}
+
+
+TTF_Font* Sys::getFont(const int& fontSize){
+    std::lock_guard<std::mutex> lock(fontMutex);
+    fontUseTick++;
+
+    auto it = fontMap.find(fontSize);
+    if(it != fontMap.end()){
+        it->second.lastUsed = fontUseTick;
+        return it->second.font;
+    }
+
+    TTF_Font* font = openFont(fontSize);
+    if(font == nullptr){
+        cout << "[FATAL] Failed to load font!" << endl;
+        return nullptr;
+    }
+
+    // Too many sizes open, close the one that wasn't used the longest
+    if(fontMap.size() >= MAX_OPEN_FONTS){
+        auto oldest = std::min_element(fontMap.begin(), fontMap.end(), [](const auto& a, const auto& b){
+            return a.second.lastUsed < b.second.lastUsed;
+        });
+        closeFont(oldest->second.font);
+        fontMap.erase(oldest);
     }
+
+    fontMap.insert({fontSize, {font, fontUseTick}});
     return font;
 }
 
@@ -187,22 +369,61 @@ TTF_Font* Sys::getFont(const int& fontSize){
  * @return 0 on success and positive on error, coresponding to ERROR DEFINITIONS
  */
 int Sys::handleEvents(){
+    PROFILE_ZONE("Sys::handleEvents");
     uint64_t error = NO_ERROR;
 
+    // IDLE MODE, WAIT FOR SOMETHING TO HAPPEN ------------------------------------------------------------------------
+    // Wake-ups requested during the last frame are due from now on
+    wakeUpAt = nextWakeUpAt;
+    nextWakeUpAt = 0;
+
+    bool mouseHeld = Mouse::heldRawL_ || Mouse::heldRawR_;
+    bool waited = false;
+    if(idleMode && !hadEvents && !mouseHeld){
+        Uint64 now = SDL_GetTicks();
+        waited = (wakeUpAt == 0 || wakeUpAt > now);
+
+        if(wakeUpAt == 0){
+            // Nothing to wait for except the events, passing nullptr leaves the event in the queue
+            SDL_WaitEventTimeout(nullptr, -1);
+        } else if(wakeUpAt > now){
+            Sint32 timeout = static_cast<Sint32>(std::min<Uint64>(wakeUpAt - now, INT32_MAX));
+            SDL_WaitEventTimeout(nullptr, timeout);
+        }
+    }
+
     // Calculate the delta Time --------------------------------------------------------------------------------------
-    frameStart = SDL_GetTicks();
+    frameStart = SDL_GetTicksNS();
+    PROFILE_FRAME(frameStart);
 
     // Avoid calculation in the first frame
-    if (previousFrameStart != 0) 
+    if (previousFrameStart != 0) {
         deltaTime = (frameStart - previousFrameStart);
+
+        // Time spent waiting for events is not a frame time
+        if(!waited){
+            frameTimes[frameTimesHead] = deltaTime;
+            frameTimesHead = (frameTimesHead + 1) % FRAME_TIME_SAMPLES;
+            frameTimesCount = std::min(frameTimesCount + 1, FRAME_TIME_SAMPLES);
+        }
+
+        fixedAccumulator = std::min(fixedAccumulator + deltaTime / 1e9, 0.25);
+    }
     
     previousFrameStart = frameStart;
 
+    // After waiting the old schedule is meaningless
+    if(waited) nextFrameDeadline = 0;
+
 
 
     // Clear the screen ----------------------------------------------------------------------------------------------
-    SDL_SetRenderDrawColor(Sys::r, clearColor.r, clearColor.g, clearColor.b, clearColor.a);
-    SDL_RenderClear(Sys::r);
+    // With damage tracking the DrawList clears only the regions that changed
+    if(!DrawList::tracking()){
+        SDL_SetRenderDrawColor(Sys::r, clearColor.r, clearColor.g, clearColor.b, clearColor.a);
+        SDL_RenderClear(Sys::r);
+        counters.clearCalls++;
+    }
 
 
     // GET NEW FRAME VALUES -------------------------------------------------------------------------------------------
@@ -212,10 +433,19 @@ int Sys::handleEvents(){
     Keyboard::clearFrame();
     Mouse   ::clearFrame();
 
+    // Async texts rendered since the last frame
+    GUI::uploadTexts();
+
     // HANDLE EVENTS --------------------------------------------------------------------------------------------------
     SDL_Event event;
+    hadEvents = false;
 
     while(SDL_PollEvent(&event)){
+        // Wake-ups from other threads only have to end the wait
+        if(wakeUpEvent != 0 && event.type == wakeUpEvent) continue;
+
+        hadEvents = true;
+
         if(event.type == SDL_EVENT_QUIT){
             isRunning = false;
         }
@@ -282,27 +512,42 @@ int Sys::handleEvents(){
  * @return 0 on success and positive on error, coresponding to ERROR DEFINITIONS
  */
 int Sys::presentFrame(){
+    PROFILE_ZONE("Sys::presentFrame");
     uint64_t error = NO_ERROR;
 
+    // DRAW THE BATCHED GUI COMMANDS ---------------------------------------------------------------------------------
+    DrawList::endFrame();
+
+
     // PRESENT THE NEW FRAME ON THE SCREEN ----------------------------------------------------------------------------
     SDL_RenderPresent(Sys::r);
+    closeFrameCounters();
+
+    // Texts not drawn for a while free their textures
+    GUI::sweepTexts();
+    TM::trimTexturePool();
+    TM::processDestroyQueue();
 
 
     // FRAME DELAY ----------------------------------------------------------------------------------------------------
-    Uint64 currentFrameDuration = SDL_GetTicks() - frameStart;
-    if((Uint64)(1000 / FPS) > currentFrameDuration){
-        uint64_t timeRemaining = (1000 / FPS) - currentFrameDuration;
-        SDL_Delay(timeRemaining);
-
-        // if(dynamicFPS){
-        //     int additionalFrames = timeRemaining / (1000 / FPS);
-        //     FPS = std::min(maxFPS, FPS + additionalFrames);
-        // }
-    } else {
-        error = SYS_FPS_TOO_HIGH;
-        // if(dynamicFPS) {
-        //     FPS = std::max(minFPS, FPS - 5);
-        // }
+    // With vsync SDL_RenderPresent already waited for the display.
+    // Otherwise frames are started on a fixed schedule, every deadline is one period
+    // after the previous one (not after the end of the frame) so the errors don't add up.
+    if(!vsync && FPS > 0){
+        Uint64 period = 1000000000ull / FPS;
+        if(nextFrameDeadline == 0) nextFrameDeadline = frameStart + period;
+
+        Uint64 now = SDL_GetTicksNS();
+        if(now < nextFrameDeadline){
+            waitUntil(nextFrameDeadline);
+            nextFrameDeadline += period;
+        } else {
+            error = SYS_FPS_TOO_HIGH;
+
+            // Slightly late frames catch up, if its more then a whole frame start over
+            if(now - nextFrameDeadline > period) nextFrameDeadline = now + period;
+            else nextFrameDeadline += period;
+        }
     }
 
 
@@ -326,8 +571,13 @@ int Sys::presentFrame(){
  */
 int Sys::cleanup(){
     // DESTROY AND FREE EVERYTHING ------------------------------------------------------------------------------------
+    ShapeAtlas::clear();
+    GlyphAtlas::clear();
+    TM::clearTexturePool();
+    TM::processDestroyQueue(true);
     SDL_DestroyWindow(win);
     SDL_DestroyRenderer(r);
+    closeFonts();
     TTF_Quit();
     SDL_Quit();
 
@@ -351,7 +601,7 @@ void Sys::setClearColor(const SDL_Color& color) { clearColor = color; }
 
 
 int Sys::getFPS() { return FPS; }
-void Sys::setFPS(const int& newFPS ) { FPS = min(max(20, newFPS), 144); }
+void Sys::setFPS(const int& newFPS ) { FPS = (newFPS == 0) ? 0 : min(max(20, newFPS), 144); nextFrameDeadline = 0; }
 // void Sys::setDynamicFPS(bool dFPS, int maxF, int minF){
 //     dynamicFPS = dFPS;
 //     maxFPS = std::max(20, maxF);
@@ -360,6 +610,108 @@ void Sys::setFPS(const int& newFPS ) { FPS = min(max(20, newFPS), 144); }
 int Sys::getCurrentFrame() { return frameCounter; }
 
 
+void Sys::waitUntil(Uint64 deadline){
+    PROFILE_ZONE("Sys::waitUntil");
+
+    // SDL_DelayNS can oversleep (usually up to a millisecond, depending on the OS),
+    // so it only sleeps until spinThreshold before the deadline, the rest is spent spinning
+    Uint64 now = SDL_GetTicksNS();
+    if(deadline > now + spinThreshold){
+        Uint64 requested = deadline - now - spinThreshold;
+        SDL_DelayNS(requested);
+
+        // Adapt the threshold to how much the sleeps overshoot on this system
+        Uint64 woke = SDL_GetTicksNS();
+        double overshoot = (woke > now + requested) ? double(woke - now - requested) : 0.0;
+        sleepOvershoot = sleepOvershoot * 0.9 + overshoot * 0.1;
+        spinThreshold = std::clamp<Uint64>(Uint64(sleepOvershoot * 2) + 100000, 200000, 4000000);
+    }
+
+    while(SDL_GetTicksNS() < deadline) this_thread::yield();
+}
+
+
+int Sys::setVSync(bool enabled){
+    if(!SDL_SetRenderVSync(r, enabled ? 1 : SDL_RENDERER_VSYNC_DISABLED)){
+        vsync = false;
+        return SYS_VSYNC_ERROR;
+    }
+
+    vsync = enabled;
+    nextFrameDeadline = 0;
+    return NO_ERROR;
+}
+
+bool Sys::isVSync() { return vsync; }
+
+double Sys::getDeltaTime() { return deltaTime / 1e9; }
+Uint64 Sys::getDeltaTimeNS() { return deltaTime; }
+
+
+void Sys::setFixedTimestep(double seconds){ fixedTimestep = std::max(seconds, 1e-4); }
+double Sys::getFixedTimestep() { return fixedTimestep; }
+
+bool Sys::stepFixed(){
+    if(fixedAccumulator < fixedTimestep) return false;
+    fixedAccumulator -= fixedTimestep;
+    return true;
+}
+
+double Sys::getFixedAlpha() { return fixedAccumulator / fixedTimestep; }
+
+
+Sys::FrameTimeStats Sys::getFrameTimeStats(){
+    FrameTimeStats stats = {};
+    stats.samples = frameTimesCount;
+    if(frameTimesCount == 0) return stats;
+
+    Uint64 sorted[FRAME_TIME_SAMPLES];
+    std::copy(frameTimes, frameTimes + frameTimesCount, sorted);
+    std::sort(sorted, sorted + frameTimesCount);
+
+    // Nearest rank percentile
+    auto percentile = [&](double p){
+        int rank = static_cast<int>(std::ceil(p * frameTimesCount)) - 1;
+        return sorted[std::clamp(rank, 0, frameTimesCount - 1)] / 1e6;
+    };
+
+    Uint64 sum = 0;
+    for(int i = 0; i < frameTimesCount; i++) sum += sorted[i];
+
+    stats.avg = (sum / double(frameTimesCount)) / 1e6;
+    stats.p50 = percentile(0.50);
+    stats.p95 = percentile(0.95);
+    stats.p99 = percentile(0.99);
+    stats.max = sorted[frameTimesCount - 1] / 1e6;
+    return stats;
+}
+
+
+void Sys::setIdleMode(bool enabled){
+    idleMode = enabled;
+    hadEvents = true;   // Don't block before the next frame is drawn
+}
+
+bool Sys::isIdleMode() { return idleMode; }
+
+void Sys::requestWakeUp(Uint32 delayMs){
+    // The main thread might be blocked in handleEvents, push an event to wake it up
+    if(!isMainThread()){
+        if(wakeUpEvent != 0){
+            SDL_Event e;
+            SDL_zero(e);
+            e.type = wakeUpEvent;
+            SDL_PushEvent(&e);
+        }
+        return;
+    }
+
+    // Keep the earliest one
+    Uint64 at = SDL_GetTicks() + delayMs;
+    if(nextWakeUpAt == 0 || at < nextWakeUpAt) nextWakeUpAt = at;
+}
+
+
 
 bool isPointInRect(SDL_Point point, SDL_Rect rect){
     return (
@@ -371,6 +723,53 @@ bool isPointInRect(SDL_Point point, SDL_Rect rect){
 }
 
 
+// Every counter of FrameCounters, so they can be summed in a loop
+static Uint64 Sys::FrameCounters::* const COUNTER_FIELDS[] = {
+    &Sys::FrameCounters::geometryCalls,
+    &Sys::FrameCounters::lineCalls,
+    &Sys::FrameCounters::fillRectCalls,
+    &Sys::FrameCounters::textureCalls,
+    &Sys::FrameCounters::clearCalls,
+    &Sys::FrameCounters::readPixelsCalls,
+    &Sys::FrameCounters::vertices,
+    &Sys::FrameCounters::indices,
+    &Sys::FrameCounters::targetSwitches,
+    &Sys::FrameCounters::texturesCreated,
+    &Sys::FrameCounters::texturesDestroyed,
+    &Sys::FrameCounters::bytesUploaded,
+    &Sys::FrameCounters::textCacheHits,
+    &Sys::FrameCounters::textCacheMisses
+};
+
+void Sys::closeFrameCounters(){
+    // The oldest frame leaves the rolling window, the new one enters it
+    FrameCounters& slot = countersHistory[countersHead];
+    for(auto field : COUNTER_FIELDS){
+        if(countersCount == FRAME_TIME_SAMPLES) rollingCounters.*field -= slot.*field;
+        rollingCounters.*field += counters.*field;
+        totalCounters.*field += counters.*field;
+    }
+
+    slot = counters;
+    countersHead = (countersHead + 1) % FRAME_TIME_SAMPLES;
+    countersCount = std::min(countersCount + 1, FRAME_TIME_SAMPLES);
+
+    lastCounters = counters;
+    counters = {};
+}
+
+Sys::FrameStats Sys::getFrameStats(){
+    return { lastCounters, rollingCounters, countersCount, totalCounters };
+}
+
+
+int Sys::dumpTrace(const string& path, int frames){
+    int err = Profiler::writeTrace(path, frames);
+    if(err == NO_ERROR) printf_info("Trace written to " + path);
+    return err;
+}
+
+
 bool Sys::isMainThread(){
     return this_thread::get_id() == mainThreadId;
 }
@@ -50,11 +50,106 @@ enum class CursorType {
 };
 
 
+
+// PROFILER -------------------------------------------------------------------
+/**
+ * @brief Scoped CPU profiling zones. The zones are only compiled when
+ * LUMOS_PROFILE is defined (`make PROFILE=1`), otherwise the macros
+ * expand to nothing and cost nothing.
+ *
+ *      void update(){
+ *          PROFILE_ZONE("update");
+ *          ...
+ *      }
+ *
+ * Every thread records into its own ring buffer, so recording never
+ * locks. Sys::dumpTrace writes the last frames as a Chrome/Perfetto
+ * trace (chrome://tracing or ui.perfetto.dev).
+ *
+ * Names must be string literals (or live as long as the program),
+ * only the pointer is stored. PROFILE_THREAD(name) names the track
+ * of the calling thread.
+ */
+#define LUMOS_CONCAT_(a, b) a##b
+#define LUMOS_CONCAT(a, b) LUMOS_CONCAT_(a, b)
+
+#ifdef LUMOS_PROFILE
+    #define PROFILE_ZONE(name)      ProfileZone LUMOS_CONCAT(profileZone_, __LINE__)(name)
+    #define PROFILE_FRAME(ns)       Profiler::frameMark(ns)
+    #define PROFILE_THREAD(name)    Profiler::setThreadName(name)
+#else
+    #define PROFILE_ZONE(name)      ((void)0)
+    #define PROFILE_FRAME(ns)       ((void)0)
+    #define PROFILE_THREAD(name)    ((void)0)
+#endif
+
+
+class Profiler {
+    friend class Sys;
+
+public:
+    struct Event {
+        const char* name;
+        Uint64 start;       // ns
+        Uint64 end;         // ns
+    };
+
+    /** @brief Stores a finished zone into the calling threads buffer. */
+    static void record(const char* name, Uint64 startNS, Uint64 endNS);
+
+    /** @brief Marks the start of a frame, called by Sys::handleEvents. */
+    static void frameMark(Uint64 ns);
+
+    /** @brief Name shown for the calling thread in the trace. */
+    static void setThreadName(const string& name);
+
+private:
+    // Power of 2, so the index can be masked insted of using %
+    static constexpr Uint64 BUFFER_EVENTS = 1 << 16;
+    static constexpr int FRAME_MARKS = 1024;
+
+    struct ThreadBuffer {
+        Event events[BUFFER_EVENTS];
+        std::atomic<Uint64> head{0};    // Events ever written, only the owner thread writes it
+        int tid;
+        string name;
+    };
+
+    // Buffers are never freed, so the events outlive their threads
+    static inline std::mutex buffersMutex;
+    static inline vector<unique_ptr<ThreadBuffer>> buffers;
+    static ThreadBuffer& localBuffer();
+
+    // Start times of the last FRAME_MARKS frames, main thread only
+    static inline Uint64 frameMarks[FRAME_MARKS] = {};
+    static inline Uint64 frameMarksCount = 0;
+
+    static int writeTrace(const string& path, int frames);
+};
+
+
+class ProfileZone {
+public:
+    ProfileZone(const char* name): name(name), start(SDL_GetTicksNS()) {}
+    ~ProfileZone(){ Profiler::record(name, start, SDL_GetTicksNS()); }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    const char* name;
+    Uint64 start;
+};
+
+
 class Sys {
     friend class Mouse;
     friend class TM;
     friend class GUI;
     friend class TextureData;
+    friend class DrawList;
+    friend class Profiler;
+    friend class GlyphAtlas;
 
 private:
     static inline int backendIndex = 0;
@@ -65,21 +160,87 @@ private:
 
     static inline int FPS = 60;
     static inline uint frameCounter             = 0;
-    static inline Uint64 frameStart             = 0;
-    static inline Uint64 previousFrameStart     = 0;
-    static inline Uint64 deltaTime              = 0;
-
+    static inline Uint64 frameStart             = 0;    // ns
+    static inline Uint64 previousFrameStart     = 0;    // ns
+    static inline Uint64 deltaTime              = 0;    // ns
+
+    // FRAME PACING, see Sys::presentFrame
+    static inline bool vsync                    = false;
+    static inline Uint64 nextFrameDeadline      = 0;        // ns, 0 = start a new schedule
+    static inline Uint64 spinThreshold          = 1000000;  // ns, the last part of the wait is spent spinning
+    static inline double sleepOvershoot         = 0;        // ns, average oversleep of SDL_DelayNS
+
+    static inline double fixedTimestep          = 1.0 / 60.0;   // s
+    static inline double fixedAccumulator       = 0;            // s
+
+    // Rolling window of the last FRAME_TIME_SAMPLES frame times, in ns
+    static constexpr int FRAME_TIME_SAMPLES = 240;
+    static inline Uint64 frameTimes[FRAME_TIME_SAMPLES] = {};
+    static inline int frameTimesHead = 0;
+    static inline int frameTimesCount = 0;
+
+    static void waitUntil(Uint64 deadlineNS);
     static inline SDL_Window* win = nullptr;
     static inline SDL_Renderer* r = nullptr;
 
     static inline string fontPath = "";
-    static inline unordered_map<int, TTF_Font*> fontMap;
+
+    // A read-only file in memory, see Sys::mapFile
+    struct MappedFile {
+        const void* data;
+        size_t size;
+        bool mapped;            // mmap, otherwise loaded with SDL_LoadFile
+    };
+
+    /**
+     * @brief Maps the whole file into memory (read only), on systems
+     * without mmap it's read with SDL_LoadFile.
+     * @return false if the file can't be read
+     */
+    static bool mapFile(const string& path, MappedFile& file);
+    static void unmapFile(MappedFile& file);
+
+    // FONTS, see Sys::getFont
+    // The font file is mapped into memory once and every size is opened from it
+
+    struct OpenFont {
+        TTF_Font* font;
+        Uint64 lastUsed;        // fontUseTick at the last getFont
+    };
+
+    static inline MappedFile fontFile = {nullptr, 0, false};
+    static inline uint64_t fontHash = 0;    // hashBytes of the font file
+    static inline unordered_map<int, OpenFont> fontMap;
+    static inline Uint64 fontUseTick = 0;
+    static inline size_t MAX_OPEN_FONTS = 16;
+
+    // fontMap is also filled by the prewarm thread
+    static inline std::mutex fontMutex;
+    static inline std::thread prewarmThread;
+    static inline std::atomic<bool> stopPrewarm{false};
+
+    // Every thread opens and closes its fonts on the one FreeType library, which
+    // needs FT_Open_Face and FT_Done_Face serialized. Taken inside openFont and
+    // closeFont, never while waiting for fontMutex
+    static inline std::mutex faceMutex;
+
+    static TTF_Font* openFont(int fontSize);
+    static void closeFont(TTF_Font* font);
+    static void prewarm(vector<int> sizes, string glyphs);
+    static void closeFonts();
 
     static inline int wWidth = 0;
     static inline int wHeight = 0;
 
     static unordered_map<int, string> errorMap;
 
+    // IDLE MODE, see Sys::setIdleMode
+    static inline bool idleMode = false;
+    static inline bool hadEvents = true;                // Last frame handled some events
+    static inline Uint64 wakeUpAt = 0;                  // Requested before this frame, 0 = none
+    static inline Uint64 nextWakeUpAt = 0;              // Being requested this frame, 0 = none
+    static inline Uint32 wakeUpEvent = 0;               // SDL user event used to wake from other threads
+
     static inline DebugLevels debugLevel = All;
     static void printf_info(string msg);
     static void printf_warn(string msg);
@@ -94,9 +255,37 @@ public:
         const int& windowHeight = 1080*0.75             // 3/4 of the screen
     );
 
-    static int initFont(const string& fontPath = "/home/data/DATA/ASSETS/Poppins/Poppins-Regular.ttf");
+    /**
+     * @brief Sets the font used by all of the GUI.
+     *
+     * If glyphAtlasPath is given, the glyphs baked into it with
+     * GlyphAtlas::bake are loaded too, so texts are drawn without
+     * rasterizing anything. A missing or outdated file is only a warning.
+     */
+    static int initFont(
+        const string& fontPath = "/home/data/DATA/ASSETS/Poppins/Poppins-Regular.ttf",
+        const string& glyphAtlasPath = ""
+    );
+
+    /**
+     * @brief Returns the font at fontSize, opening it if needed.
+     * Only the last MAX_OPEN_FONTS sizes are kept open, so don't hold
+     * on to the pointer, get it again when you need it. Main thread only.
+     */
     static TTF_Font* getFont(const int& fontSize);
 
+    // Printable ASCII, the default glyphset of Sys::prewarmFonts
+    static inline const string PREWARM_GLYPHS =
+        " !\"#$%&'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_`abcdefghijklmnopqrstuvwxyz{|}~";
+
+    /**
+     * @brief Opens the sizes on a background thread and renders every glyph
+     * of `glyphs` with them, so the first frame using one of these sizes
+     * doesn't stall on opening the font. Call it after Sys::initFont,
+     * best right at startup.
+     */
+    static int prewarmFonts(const vector<int>& sizes, const string& glyphs = PREWARM_GLYPHS);
+
     static int handleEvents();
     static int presentFrame();
     static int cleanup();
@@ -108,9 +297,161 @@ public:
     static bool isMainThread();
 
     static int getFPS();
+
+    /**
+     * @brief Sets the frame limit, clamped to 20-144.
+     * 0 removes the limit (Sys::presentFrame never waits),
+     * for benchmarks and tools.
+     */
     static void setFPS(const int& newFPS);
     static int getCurrentFrame();
 
+    /**
+     * @brief Paces the frames with the display refresh insted of sleeping.
+     * When its on, Sys::presentFrame doesn't sleep and FPS is ignored.
+     *
+     * @return NO_ERROR or SYS_VSYNC_ERROR if the renderer doesn't support it
+     */
+    static int setVSync(bool enabled = true);
+    static bool isVSync();
+
+    /** @brief Time between the start of the last and the current frame, in seconds. */
+    static double getDeltaTime();
+
+    /** @brief Time between the start of the last and the current frame, in nanoseconds. */
+    static Uint64 getDeltaTimeNS();
+
+    /**
+     * @brief Fixed timestep updates. Every frame the delta time is added
+     * to an accumulator and every call to stepFixed() takes one step
+     * out of it, so the logic runs at the same rate regardless of FPS:
+     *
+     *      while(Sys::stepFixed()) update(Sys::getFixedTimestep());
+     *
+     * getFixedAlpha() returns how far (0-1) the frame is between the
+     * last and the next step, for interpolation while rendering.
+     * The accumulator is capped at 0.25s so a long stall doesn't
+     * cause an avalanche of steps.
+     */
+    static void setFixedTimestep(double seconds);
+    static double getFixedTimestep();
+    static bool stepFixed();
+    static double getFixedAlpha();
+
+    /**
+     * @brief Frame time statistics over the last FRAME_TIME_SAMPLES frames,
+     * in milliseconds. Frames that waited for events in idle mode are
+     * not counted.
+     */
+    struct FrameTimeStats {
+        double avg;
+        double p50;
+        double p95;
+        double p99;
+        double max;
+        int samples;
+    };
+    static FrameTimeStats getFrameTimeStats();
+
+    /**
+     * @brief Renderer work counters, counted by Lumos' own wrappers
+     * (DrawList, TM::createTexture, TM::updateTexture, TM::setRenderTarget...),
+     * so anything drawn with raw SDL calls is not included.
+     *
+     * geometryCalls ... readPixelsCalls - renderer calls by kind
+     * vertices, indices                 - submitted with SDL_RenderGeometry
+     * targetSwitches                    - SDL_SetRenderTarget calls that changed the target
+     * bytesUploaded                     - trough TM::updateTexture (SDL_UpdateTexture)
+     * textCacheHits, textCacheMisses    - lookups of GUI::loadedTexts
+     */
+    struct FrameCounters {
+        Uint64 geometryCalls;
+        Uint64 lineCalls;
+        Uint64 fillRectCalls;
+        Uint64 textureCalls;
+        Uint64 clearCalls;
+        Uint64 readPixelsCalls;
+
+        Uint64 vertices;
+        Uint64 indices;
+        Uint64 targetSwitches;
+
+        Uint64 texturesCreated;
+        Uint64 texturesDestroyed;
+        Uint64 bytesUploaded;
+
+        Uint64 textCacheHits;
+        Uint64 textCacheMisses;
+
+        /** @brief Sum of all of the renderer calls. */
+        Uint64 renderCalls() const {
+            return geometryCalls + lineCalls + fillRectCalls + textureCalls + clearCalls + readPixelsCalls;
+        }
+    };
+
+    /**
+     * lastFrame - counters of the last presented frame
+     * rolling   - sum over the last `rollingFrames` frames (up to FRAME_TIME_SAMPLES),
+     *             divide by rollingFrames for the per-frame average
+     * total     - since the start of the program
+     */
+    struct FrameStats {
+        FrameCounters lastFrame;
+        FrameCounters rolling;
+        int rollingFrames;
+        FrameCounters total;
+    };
+    static FrameStats getFrameStats();
+
+private:
+    // RENDERER COUNTERS, they need the structs above
+    static inline FrameCounters counters = {};          // Being filled this frame
+    static inline FrameCounters lastCounters = {};
+    static inline FrameCounters totalCounters = {};
+    static inline FrameCounters rollingCounters = {};
+    static inline FrameCounters countersHistory[FRAME_TIME_SAMPLES] = {};
+    static inline int countersHead = 0;
+    static inline int countersCount = 0;
+    static void closeFrameCounters();
+
+public:
+
+    /**
+     * @brief Idle mode, for apps that don't need to redraw unless
+     * something happens.
+     *
+     * When its on, Sys::handleEvents blocks (SDL_WaitEventTimeout)
+     * until there is a new event or until a requested wake-up time,
+     * instead of running every frame. A frame that handled events is
+     * always followed by one more, so the UI can settle, and nothing
+     * blocks while a mouse button is held.
+     *
+     * Anything that animates (like the Input caret) must request
+     * a wake-up with Sys::requestWakeUp, or it will freeze.
+     */
+    static void setIdleMode(bool enabled = true);
+    static bool isIdleMode();
+
+    /**
+     * @brief Asks for a frame to be run after delayMs milliseconds,
+     * 0 means the next frame. Requests last for one frame, so keep
+     * requesting them while the animation is running.
+     *
+     * Can be called from any thread, from other threads it
+     * wakes the main thread immediately.
+     */
+    static void requestWakeUp(Uint32 delayMs = 0);
+
+    /**
+     * @brief Writes the profiling zones of the last `frames` frames
+     * (from every thread) into a Chrome/Perfetto JSON trace.
+     * Only has something to write when built with LUMOS_PROFILE,
+     * see PROFILE_ZONE. Call it from the main thread.
+     *
+     * @return NO_ERROR or SYS_TRACE_WRITE_ERROR
+     */
+    static int dumpTrace(const string& path, int frames = 120);
+
     static string checkError(int error);
 
     static inline bool isRunning = true;
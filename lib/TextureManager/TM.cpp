@@ -1,9 +1,11 @@
 #include "./TM.h"
 #include "../System/Sys.h"
+#include "../GUI/gui.h"
 
 
 
 static int trailing_zeros_u32(uint32_t x) { return __builtin_ctz(x); }
+int ensureSurfaceFormat(SDL_Surface*& surface);
 
 
 /* TEXTURE DATA FUNCTIONS AND DEFINITIONS */
@@ -46,23 +48,17 @@ void TextureData::reloadInfo(){
 }
 
 void TextureData::setTexture(SDL_Texture* newTex){
-    // if we already had one, and no other Impl is holding it, free it:
-    if (dptr_->texture) {
-        bool otherAlive = false;
-        for (auto &wk : TM::loadedTextures) {
-            if (auto sp = wk.lock()) {
-                if (sp.get() != dptr_.get() && sp->texture == dptr_->texture) {
-                    otherAlive = true;
-                    break;
-                }
-            }
-        }
-        if (!otherAlive) {
-            if (TM::AUTO_DELETE_TEXTURES)
-                SDL_DestroyTexture(dptr_->texture);
-            else
-                TM::outOfScopeTextures.push_back(dptr_->texture);
-        }
+    // Not the loaded file anymore, so it can't be evicted and loaded again
+    if (!dptr_->source.empty()) {
+        TM::unlinkTexture(dptr_.get());
+        dptr_->source.clear();
+        dptr_->evicted = false;
+    }
+
+    // Setting the same texture again must not free it
+    if (newTex != dptr_->texture) {
+        TM::retainTexture(newTex);
+        if (dptr_->texture) TM::releaseTexture(dptr_->texture, true);
     }
 
     dptr_->texture = newTex;
@@ -71,21 +67,18 @@ void TextureData::setTexture(SDL_Texture* newTex){
     reloadInfo();
 }
 
-TextureData::~TextureData(){
-    if (dptr_.unique()) {
-        if (dptr_->texture) {
-            SDL_DestroyTexture(dptr_->texture);
-            dptr_->texture = nullptr;
-        }
-        TM::removeTexture(dptr_);
-    }
+TextureData::~TextureData(){}
+
+TextureData::Impl::~Impl(){
+    // Copies share the Impl, so this runs once the last one is gone
+    TM::unlinkTexture(this);
+    if (texture) TM::releaseTexture(texture, false);
 }
 
-TextureData::TextureData(): dptr_(std::make_shared<Impl>())
+TextureData::TextureData(): dptr_(new Impl(), TM::deleteImpl)
 {
     // give it a default autogenerated id if you like:
     id = "Empty";
-    TM::registerTexture(dptr_);
 }
 
 void TextureData::printf(bool full) const {
@@ -106,29 +99,543 @@ void TextureData::printf(bool full) const {
 
 /* BASIC TEXTURE MANAGER PRIVATE/SETTINGS FUNCTIONS */
 
-void TM::registerTexture(std::shared_ptr<TextureData::Impl> const& ptr) {
-    loadedTextures.push_back(ptr);
+void TM::retainTexture(SDL_Texture* tex) {
+    if (tex) textureRefs[tex]++;
 }
 
 
-void TM::removeTexture(std::shared_ptr<TextureData::Impl> dead) {
-    auto &v = loadedTextures;
-    v.erase(
-      std::remove_if(v.begin(), v.end(),
-        [&](auto &wk){
-          auto sp = wk.lock();
-          // remove if expired OR matches the one we’re removing:
-          return !sp || sp == dead;
-        }
-      ),
-      v.end()
-    );
+void TM::releaseTexture(SDL_Texture* tex, bool replaced) {
+    auto it = textureRefs.find(tex);
+    if (it != textureRefs.end() && --it->second > 0) return;
+    if (it != textureRefs.end()) textureRefs.erase(it);
+
+    // Going out of scope always frees it, replacing it only if AUTO_DELETE_TEXTURES
+    // or TM made it. Otherwise it belongs to whoever set it
+    auto info = textureInfo.find(tex);
+    bool owned = info != textureInfo.end() && info->second.owned;
+    if (!replaced || AUTO_DELETE_TEXTURES || owned)
+        TM::destroyTexture(tex);
+}
+
+
+void TM::ownTexture(SDL_Texture* tex) {
+    auto it = textureInfo.find(tex);
+    if (it != textureInfo.end()) it->second.owned = true;
 }
 
 
 void TM::setAutoDeleteTextures(bool prop){ AUTO_DELETE_TEXTURES = prop; }
 
 
+SDL_Texture* TM::createTexture(
+    SDL_PixelFormat     format,
+    SDL_TextureAccess   access,
+    int                 width,
+    int                 height
+){
+    SDL_Texture* tex = SDL_CreateTexture(Sys::renderer, format, access, width, height);
+    if(tex == nullptr) return nullptr;
+
+    createdTexturesCount++;
+    Sys::counters.texturesCreated++;
+
+    size_t bytes = size_t(width) * height * SDL_BYTESPERPIXEL(format);
+    textureInfo[tex] = {bytes, TextureCategory::SCRATCH, format, access, width, height};
+    categoryBytes[int(TextureCategory::SCRATCH)] += bytes;
+    totalTextureBytes += bytes;
+
+    // Might be at the address of a destroyed texture, so
+    // the damage tracking must not think it's the same one
+    DrawList::invalidateTexture(tex);
+    return tex;
+}
+
+
+bool TM::updateTexture(SDL_Texture* tex, const SDL_Rect* rect, const void* pixels, int pitch){
+    if(!SDL_UpdateTexture(tex, rect, pixels, pitch)) return false;
+
+    int rows = 0;
+    if(rect != nullptr) rows = rect->h;
+    else {
+        float w = 0, h = 0;
+        SDL_GetTextureSize(tex, &w, &h);
+        rows = static_cast<int>(h);
+    }
+    Sys::counters.bytesUploaded += static_cast<Uint64>(rows) * std::abs(pitch);
+
+    DrawList::invalidateTexture(tex);
+    return true;
+}
+
+
+
+bool TM::setRenderTarget(SDL_Texture* target){
+    if(SDL_GetRenderTarget(Sys::renderer) != target) Sys::counters.targetSwitches++;
+    return SDL_SetRenderTarget(Sys::renderer, target);
+}
+
+
+
+void TM::destroyTexture(SDL_Texture* tex){
+    if(tex == nullptr) return;
+
+    // Gone as far as the memory is concerned, even if destroyed a bit later
+    auto it = textureInfo.find(tex);
+    if(it != textureInfo.end() && it->second.pooled){
+        // Pool textures wait for the next TM::acquireTexture insted
+        const TextureInfo& info = it->second;
+        setTextureCategory(tex, TextureCategory::SCRATCH);
+        it->second.owned = false;
+        texturePool[{info.format, info.access, info.width, info.height}].push_back({tex, Sys::getCurrentFrame()});
+        pooledCount++;
+        pooledBytes += info.bytes;
+        return;
+    }
+    if(it != textureInfo.end()){
+        categoryBytes[int(it->second.category)] -= it->second.bytes;
+        totalTextureBytes -= it->second.bytes;
+        textureInfo.erase(it);
+    }
+
+    destroyQueue.push_back({tex, Sys::getCurrentFrame()});
+}
+
+
+void TM::flushDestroyedTextures(){
+    if(DrawList::hasPending()) return;
+    processDestroyQueue(true);
+}
+
+
+void TM::deleteImpl(TextureData::Impl* impl){
+    if(Sys::isMainThread()){
+        delete impl;
+        return;
+    }
+
+    TextureData::Impl* head = pendingImpls.load(std::memory_order_relaxed);
+    do {
+        impl->pendingNext = head;
+    } while(!pendingImpls.compare_exchange_weak(head, impl, std::memory_order_release, std::memory_order_relaxed));
+}
+
+
+void TM::processDestroyQueue(bool all){
+    PROFILE_ZONE("TM::processDestroyQueue");
+
+    // Impls dropped on other threads, their textures go into the queue below
+    TextureData::Impl* impl = pendingImpls.exchange(nullptr, std::memory_order_acquire);
+    while(impl != nullptr){
+        TextureData::Impl* next = impl->pendingNext;
+        delete impl;
+        impl = next;
+    }
+
+    // Oldest are at the front
+    int frame = Sys::getCurrentFrame();
+    size_t count = 0;
+    while(count < destroyQueue.size()){
+        const DestroyedTexture& d = destroyQueue[count];
+        int age = frame - d.frame;
+        if(!all && age >= 0 && age < DESTROY_DELAY_FRAMES) break;
+
+        DrawList::textureDestroyed(d.texture);
+        SDL_DestroyTexture(d.texture);
+        count++;
+    }
+    destroyQueue.erase(destroyQueue.begin(), destroyQueue.begin() + count);
+}
+
+
+Uint64 TM::getCreatedTexturesCount(){ return createdTexturesCount; }
+
+
+
+// TEXTURE POOL ---------------------------------------------------------------
+SDL_Texture* TM::acquireTexture(
+    SDL_PixelFormat     format,
+    SDL_TextureAccess   access,
+    int                 width,
+    int                 height
+){
+    // The front of the FIFO was released first, if it's too recent so is the rest
+    auto it = texturePool.find({format, access, width, height});
+    if(it != texturePool.end()){
+        int age = Sys::getCurrentFrame() - it->second.front().releasedFrame;
+
+        if(age < 0 || age >= POOL_DELAY_FRAMES){
+            SDL_Texture* tex = it->second.front().texture;
+            it->second.pop_front();
+            if(it->second.empty()) texturePool.erase(it);
+
+            pooledCount--;
+            pooledBytes -= textureBytes(tex);
+            poolHits++;
+
+            // Whoever had it might have changed these, back to how SDL makes them
+            SDL_SetTextureColorMod(tex, 255, 255, 255);
+            SDL_SetTextureAlphaMod(tex, 255);
+            SDL_SetTextureBlendMode(tex, SDL_ISPIXELFORMAT_ALPHA(format) ? SDL_BLENDMODE_BLEND : SDL_BLENDMODE_NONE);
+            SDL_SetTextureScaleMode(tex, SDL_SCALEMODE_LINEAR);
+
+            // New contents as far as the damage tracking is concerned
+            DrawList::invalidateTexture(tex);
+            return tex;
+        }
+    }
+
+    poolMisses++;
+    SDL_Texture* tex = createTexture(format, access, width, height);
+    if(tex == nullptr) return nullptr;
+
+    TextureInfo& info = textureInfo[tex];
+    info.pooled = true;
+    poolTextures++;
+    poolTextureBytes += info.bytes;
+    return tex;
+}
+
+
+void TM::unpoolTexture(SDL_Texture* tex){
+    auto it = textureInfo.find(tex);
+    if(it == textureInfo.end() || !it->second.pooled) return;
+
+    it->second.pooled = false;
+    poolTextures--;
+    poolTextureBytes -= it->second.bytes;
+}
+
+
+void TM::dropPooledTexture(std::deque<PooledTexture>& fifo){
+    SDL_Texture* tex = fifo.front().texture;
+    fifo.pop_front();
+
+    pooledCount--;
+    pooledBytes -= textureBytes(tex);
+    unpoolTexture(tex);
+    destroyTexture(tex);
+}
+
+
+void TM::trimTexturePool(){
+    int frame = Sys::getCurrentFrame();
+
+    // Waited for too long, oldest are at the front of every FIFO
+    for(auto it = texturePool.begin(); it != texturePool.end();){
+        auto& fifo = it->second;
+        while(!fifo.empty()){
+            int age = frame - fifo.front().releasedFrame;
+            if(age >= 0 && age <= POOL_MAX_AGE) break;
+            dropPooledTexture(fifo);
+        }
+
+        if(fifo.empty()) it = texturePool.erase(it);
+        else ++it;
+    }
+
+    shrinkTexturePool(POOL_MAX_BYTES);
+}
+
+
+void TM::shrinkTexturePool(size_t maxBytes){
+    // The oldest of all go first
+    while(pooledBytes > maxBytes && !texturePool.empty()){
+        auto oldest = texturePool.begin();
+        for(auto it = texturePool.begin(); it != texturePool.end(); ++it){
+            if(it->second.front().releasedFrame < oldest->second.front().releasedFrame) oldest = it;
+        }
+
+        dropPooledTexture(oldest->second);
+        if(oldest->second.empty()) texturePool.erase(oldest);
+    }
+}
+
+
+void TM::clearTexturePool(){
+    for(auto& [key, fifo] : texturePool){
+        while(!fifo.empty()) dropPooledTexture(fifo);
+    }
+    texturePool.clear();
+}
+
+
+TexturePoolStats TM::getTexturePoolStats(){
+    TexturePoolStats s;
+    s.hits        = poolHits;
+    s.misses      = poolMisses;
+    s.pooled      = pooledCount;
+    s.pooledBytes = pooledBytes;
+    s.inUse       = poolTextures - s.pooled;
+    s.inUseBytes  = poolTextureBytes - pooledBytes;
+    return s;
+}
+
+
+
+// LOAD CACHE -----------------------------------------------------------------
+void TM::invalidateLoadCache(const string& path){
+    if(path.empty()){
+        loadCache.clear();
+        return;
+    }
+
+    std::error_code ec;
+    fs::path canonical = fs::weakly_canonical(path, ec);
+    loadCache.erase(ec ? path : canonical.string());
+}
+
+
+string TM::loadCacheKey(const string& path, uintmax_t& size, fs::file_time_type& mtime){
+    std::error_code ec;
+    fs::path canonical = fs::weakly_canonical(path, ec);
+    if(ec) return "";
+
+    size = fs::file_size(canonical, ec);
+    if(ec) return "";
+    mtime = fs::last_write_time(canonical, ec);
+    if(ec) return "";
+
+    return canonical.string();
+}
+
+
+SDL_Texture* TM::findLoadCache(const string& key, uintmax_t size, fs::file_time_type mtime){
+    auto it = loadCache.find(key);
+    if(it != loadCache.end()){
+        const LoadCacheEntry& entry = it->second;
+        auto impl = entry.impl.lock();
+
+        if(impl && impl->texture && impl->source == entry.source && entry.size == size && entry.mtime == mtime){
+            loadCacheHits++;
+            return impl->texture;
+        }
+
+        // Changed on disk, evicted or not loaded anymore
+        loadCache.erase(it);
+    }
+
+    loadCacheMisses++;
+    return nullptr;
+}
+
+
+void TM::storeLoadCache(
+    const string& key,
+    const std::shared_ptr<TextureData::Impl>& impl,
+    uintmax_t size,
+    fs::file_time_type mtime
+){
+    // Entries of textures that are gone pile up, they're dropped now and then
+    if(loadCache.size() >= loadCacheSweepAt){
+        std::erase_if(loadCache, [](const auto& e){ return e.second.impl.expired(); });
+        loadCacheSweepAt = std::max<size_t>(64, loadCache.size() * 2);
+    }
+    loadCache[key] = {impl, impl->source, size, mtime};
+}
+
+
+LoadCacheStats TM::getLoadCacheStats(){
+    return {loadCacheHits, loadCacheMisses, static_cast<int>(loadCache.size())};
+}
+
+
+
+// TEXTURE MEMORY -------------------------------------------------------------
+size_t TM::textureBytes(SDL_Texture* tex){
+    auto it = textureInfo.find(tex);
+    return (it != textureInfo.end()) ? it->second.bytes : 0;
+}
+
+
+void TM::setTextureCategory(SDL_Texture* tex, TextureCategory category){
+    auto it = textureInfo.find(tex);
+    if(it == textureInfo.end()) return;
+
+    categoryBytes[int(it->second.category)] -= it->second.bytes;
+    categoryBytes[int(category)] += it->second.bytes;
+    it->second.category = category;
+}
+
+
+void TM::setTextureBudget(size_t bytes){
+    textureBudget = bytes;
+    enforceTextureBudget();
+}
+
+
+TextureMemory TM::getTextureMemory(){
+    TextureMemory m;
+    m.total     = totalTextureBytes;
+    m.images    = categoryBytes[int(TextureCategory::IMAGES)];
+    m.text      = categoryBytes[int(TextureCategory::TEXT)];
+    m.icons     = categoryBytes[int(TextureCategory::ICONS)];
+    m.scratch   = categoryBytes[int(TextureCategory::SCRATCH)];
+    // Only textures that every TextureData pointing to them can load again
+    m.evictable = 0;
+    for(auto it = lruTextures.begin(); it != lruTextures.end(); it = lruTextures.equal_range(it->first).second){
+        auto ref = textureRefs.find(it->first);
+        int count = static_cast<int>(lruTextures.count(it->first));
+        if(ref == textureRefs.end() || ref->second == count) m.evictable += textureBytes(it->first);
+    }
+    m.budget    = textureBudget;
+    m.textures  = static_cast<int>(textureInfo.size());
+    m.evictions = evictionCount;
+    m.reloads   = reloadCount;
+    return m;
+}
+
+
+void TM::linkTexture(TextureData::Impl* impl){
+    if(impl->inLru) return;
+
+    impl->inLru = true;
+    impl->lruPrev = nullptr;
+    impl->lruNext = lruFront;
+    if(lruFront) lruFront->lruPrev = impl;
+    lruFront = impl;
+    if(lruBack == nullptr) lruBack = impl;
+
+    lruTextures.insert({impl->texture, impl});
+}
+
+
+void TM::unlinkTexture(TextureData::Impl* impl){
+    if(!impl->inLru) return;
+
+    if(impl->lruPrev) impl->lruPrev->lruNext = impl->lruNext;
+    else lruFront = impl->lruNext;
+    if(impl->lruNext) impl->lruNext->lruPrev = impl->lruPrev;
+    else lruBack = impl->lruPrev;
+
+    impl->inLru = false;
+    impl->lruPrev = impl->lruNext = nullptr;
+
+    auto range = lruTextures.equal_range(impl->texture);
+    for(auto it = range.first; it != range.second; it++){
+        if(it->second == impl){ lruTextures.erase(it); break; }
+    }
+}
+
+
+bool TM::canEvict(SDL_Texture* tex, int frame){
+    auto range = lruTextures.equal_range(tex);
+
+    int count = 0;
+    for(auto it = range.first; it != range.second; it++){
+        if(it->second->lastUsedFrame == frame) return false;
+        count++;
+    }
+
+    // Anything else pointing to it (a copy that was setTexture-d) would lose it
+    auto ref = textureRefs.find(tex);
+    return ref == textureRefs.end() || ref->second == count;
+}
+
+
+void TM::evictTexture(SDL_Texture* tex){
+    // The Impls keep their size and format, only the pixels are gone
+    auto range = lruTextures.equal_range(tex);
+    vector<TextureData::Impl*> impls;
+    for(auto it = range.first; it != range.second; it++) impls.push_back(it->second);
+
+    for(TextureData::Impl* impl : impls){
+        unlinkTexture(impl);
+        impl->texture = nullptr;
+        impl->evicted = true;
+    }
+
+    textureRefs.erase(tex);
+    destroyTexture(tex);
+    evictionCount++;
+}
+
+
+void TM::enforceTextureBudget(){
+    if(textureBudget == 0 || totalTextureBytes <= textureBudget) return;
+
+    // Idle pool textures are counted too, they go before anything in use
+    size_t over = totalTextureBytes - textureBudget;
+    shrinkTexturePool(pooledBytes > over ? pooledBytes - over : 0);
+
+    int frame = Sys::getCurrentFrame();
+    TextureData::Impl* impl = lruBack;
+
+    while(impl != nullptr && totalTextureBytes > textureBudget){
+        // Everything after it was used even more recently
+        if(impl->lastUsedFrame == frame) break;
+
+        // Other Impls of the same texture get unlinked too, the next
+        // one to look at can't be one of them
+        SDL_Texture* tex = impl->texture;
+        TextureData::Impl* next = impl->lruPrev;
+        while(next != nullptr && next->texture == tex) next = next->lruPrev;
+
+        if(canEvict(tex, frame)) evictTexture(tex);
+
+        impl = next;
+    }
+}
+
+
+SDL_Texture* TM::useTexture(const TextureData& td){
+    TextureData::Impl* impl = td.dptr_.get();
+    if(impl->source.empty()) return impl->texture;
+
+    impl->lastUsedFrame = Sys::getCurrentFrame();
+
+    if(impl->evicted){
+        PROFILE_ZONE("TM::useTexture reload");
+
+        // Other TextureData of the same file might have loaded it again already
+        uintmax_t size = 0;
+        fs::file_time_type mtime;
+        string key = loadCacheKey(impl->source, size, mtime);
+        SDL_Texture* tex = key.empty() ? nullptr : findLoadCache(key, size, mtime);
+
+        if(tex == nullptr){
+            SDL_Surface* surface = IMG_Load(impl->source.c_str());
+            if(surface == nullptr || ensureSurfaceFormat(surface) != NO_ERROR){
+                CHECK_ERROR(TM_SURFACE_CREATE_ERROR);
+                return nullptr;
+            }
+
+            int err = convert_toTexture(surface, tex);
+            SDL_DestroySurface(surface);
+            if(err != NO_ERROR){
+                CHECK_ERROR(err);
+                return nullptr;
+            }
+
+            setTextureCategory(tex, TextureCategory::IMAGES);
+            reloadCount++;
+        }
+
+        retainTexture(tex);
+        impl->texture = tex;
+        impl->evicted = false;
+        if(!key.empty() && loadCache.find(key) == loadCache.end()) storeLoadCache(key, td.dptr_, size, mtime);
+
+        linkTexture(impl);
+        enforceTextureBudget();
+        return impl->texture;
+    }
+
+    // Move it to the front of the LRU list, lruTextures stays the same
+    if(impl->inLru && impl != lruFront){
+        impl->lruPrev->lruNext = impl->lruNext;
+        if(impl->lruNext) impl->lruNext->lruPrev = impl->lruPrev;
+        else lruBack = impl->lruPrev;
+
+        impl->lruPrev = nullptr;
+        impl->lruNext = lruFront;
+        lruFront->lruPrev = impl;
+        lruFront = impl;
+    }
+
+    return impl->texture;
+}
+
+
 
 
 ///////////////////////////////////////////////////////////////////////////////////////////
@@ -309,13 +816,14 @@ SDL_Texture* SVGIcon::loadSize(int size){
     }
 
     // Create texture and upload (pitch in bytes)
-    SDL_Texture *tex = SDL_CreateTexture(Sys::renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STATIC, size, size);
+    SDL_Texture *tex = TM::createTexture(SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STATIC, size, size);
     if (!tex) { 
         std::fprintf(stderr,"SDL_CreateTexture: %s\n", SDL_GetError()); 
         return nullptr;
     }
+    TM::setTextureCategory(tex, TextureCategory::ICONS);
 
-    if (!SDL_UpdateTexture(tex, NULL, pixels, size * 4)) {
+    if (!TM::updateTexture(tex, NULL, pixels, size * 4)) {
         std::fprintf(stderr, "SDL_UpdateTexture: %s\n", SDL_GetError());
         return nullptr;
     }
@@ -356,6 +864,34 @@ int TM::loadTexture(
     const string&       path, 
     const string&       id
 ){
+    PROFILE_ZONE("TM::loadTexture");
+
+    // LOAD CACHE ---------------------------------------------------------------------------------
+    // If the file was loaded already td gets the same SDL_Texture*, it's counted
+    // in textureRefs like any other. Files that can't be stat-ed are just loaded,
+    // without the cache
+    uintmax_t fileSize = 0;
+    fs::file_time_type mtime;
+    string key = loadCacheKey(path, fileSize, mtime);
+
+    SDL_Texture* cached = key.empty() ? nullptr : findLoadCache(key, fileSize, mtime);
+    if(cached != nullptr){
+        // Retained before the old one is released, so loading the same file
+        // into the same td again doesn't free it
+        td.setTexture(cached);
+        td.orgWidth = td.getWidth();
+        td.orgHeight = td.getHeight();
+        td.path = path;
+        if(id.empty()) td.id = fs::path(path).filename().string();
+        else td.id = id;
+
+        td.dptr_->source = path;
+        td.dptr_->lastUsedFrame = Sys::getCurrentFrame();
+        linkTexture(td.dptr_.get());
+
+        return NO_ERROR;
+    }
+
     // Just in case there was something in the td object, free it ---------------------------------
     td.setTexture(nullptr);
 
@@ -367,10 +903,16 @@ int TM::loadTexture(
     int errorCode = ensureSurfaceFormat(surface);
     if(errorCode) return errorCode;
 
-    SDL_Texture* tex;
-    convert_toTexture(surface, tex);
+    // On failure the texture is already destroyed, nothing of it may be kept
+    SDL_Texture* tex = nullptr;
+    errorCode = convert_toTexture(surface, tex);
+    if(errorCode){
+        SDL_DestroySurface(surface);
+        return errorCode;
+    }
 
     // Set the texture ----------------------------------------------------------------------------
+    ownTexture(tex);
     td.setTexture(tex);
 
     // GET TEXTURE DIMENSIONS ---------------------------------------------------------------------
@@ -386,6 +928,16 @@ int TM::loadTexture(
     // CLEAN UP ---------------------------------------------------------------------------
     SDL_DestroySurface(surface);
 
+    // MEMORY -------------------------------------------------------------------------------------
+    // It can be loaded again from the file, so it can be evicted when over the budget
+    setTextureCategory(tex, TextureCategory::IMAGES);
+    td.dptr_->source = path;
+    td.dptr_->lastUsedFrame = Sys::getCurrentFrame();
+    linkTexture(td.dptr_.get());
+    enforceTextureBudget();
+
+    if(!key.empty()) storeLoadCache(key, td.dptr_, fileSize, mtime);
+
     return NO_ERROR;
 }
 
@@ -414,6 +966,8 @@ int TM::createTextTexture(
     int                 fontSize,
     SDL_Color           color
 ) {
+    PROFILE_ZONE("TM::createTextTexture");
+
     if(Sys::fontPath == "") {
         CHECK_ERROR(SYS_FONT_NOT_INITED);
         exit(EXIT_FAILURE);
@@ -439,13 +993,19 @@ int TM::createTextTexture(
     if(errorCode) return errorCode;
 
     // Create texture from it and store it in TextureData
-    SDL_Texture* tex;
-    convert_toTexture(surface, tex);
+    SDL_Texture* tex = nullptr;
+    errorCode = convert_toTexture(surface, tex);
+    if(errorCode){
+        SDL_DestroySurface(surface);
+        return errorCode;
+    }
+    setTextureCategory(tex, TextureCategory::TEXT);
 
     td.path = "TEXT";
     td.id = "TEXT-" + text;
 
     // SET THE TEXTURE --------------------------------------------------------------------
+    ownTexture(tex);
     td.setTexture(tex);
 
     // GET TEXTURE DIMENSIONS -------------------------------------------------------------
@@ -464,34 +1024,38 @@ int TM::copyTexture(
     const TextureData&  src, 
     TextureData&        dst
 ) {
-    // Check for valid pointers.
-    if (!src.getTexture()) {
+    // Check for valid pointers, evicted textures are loaded again
+    if (!useTexture(src)) {
         return INVALID_ARGUMENTS_PASSED;
     }
 
-    // Create a new texture with the same format, access and dimensions as src.
-    SDL_Texture* newTex = SDL_CreateTexture(
-        Sys::renderer,
+    // Create a new texture with the same format and dimensions as src,
+    // TARGET as the copy is rendered into it
+    SDL_Texture* newTex = acquireTexture(
         src.getFormat(),
-        src.getAccess(),
+        SDL_TEXTUREACCESS_TARGET,
         src.getWidth(),
         src.getHeight()
     );
     if(!newTex) return TM_TEXTURE_CREATE_ERROR;
 
+    // Draw pending GUI commands first, they might be drawing into src
+    DrawList::flush();
+
     // Capture the previous target
     auto old_renderTarget = SDL_GetRenderTarget(Sys::renderer);
 
     // Set the new texture as the render target.
-    bool err = SDL_SetRenderTarget(Sys::renderer, newTex);
+    bool err = TM::setRenderTarget(newTex);
     if (!err) {
-        SDL_DestroyTexture(newTex);
+        TM::destroyTexture(newTex);
         return TM_SRT_FAILED; // Set Render Target FAILED.
     }
 
     // Clear the render target (fill with blue)
     SDL_SetRenderDrawColor(Sys::renderer, 0, 0, 0, 0);
     SDL_RenderClear(Sys::renderer);
+    Sys::counters.clearCalls++;
 
     // Copy the source texture onto the new texture.
     err = SDL_RenderTexture(
@@ -500,30 +1064,32 @@ int TM::copyTexture(
         nullptr, 
         nullptr
     );
+    Sys::counters.textureCalls++;
     if (!err) {
-        SDL_SetRenderTarget(Sys::renderer, old_renderTarget);
-        SDL_DestroyTexture(newTex);
+        TM::setRenderTarget(old_renderTarget);
+        TM::destroyTexture(newTex);
         return TM_RCPY_FAILED; // Render Copy FAILED
     }
 
     // Reset the render target back to the default
-    SDL_SetRenderTarget(Sys::renderer, old_renderTarget);
+    TM::setRenderTarget(old_renderTarget);
 
     // Set Scale Mode for the Texture -------------------------------------------------------------
     err = SDL_SetTextureScaleMode(newTex, SDL_SCALEMODE_LINEAR);
     if(!err){
-        SDL_DestroyTexture(newTex);
+        TM::destroyTexture(newTex);
         return TM_STSM_FAILED;
     }
 
     // Make texture Updatable/Modifiable ----------------------------------------------------------
     err = SDL_SetTextureBlendMode(newTex, SDL_BLENDMODE_BLEND);
     if(!err){
-        SDL_DestroyTexture(newTex);
+        TM::destroyTexture(newTex);
         return TM_TEXTURE_SET_BLENDMODE_ERROR;
     }
 
     // Use the destination object's setTexture method to update its texture.
+    ownTexture(newTex);
     dst.setTexture(newTex);
 
     // Copy metadata from src to dst.
@@ -544,7 +1110,7 @@ int TM::resizeTexture(
     int&                newWidth,
     int&                newHeight
 ){
-    if (!src.getTexture()) 
+    if (!useTexture(src)) 
         return INVALID_ARGUMENTS_PASSED;
 
     if (newWidth == -1 && newHeight == -1) 
@@ -559,11 +1125,10 @@ int TM::resizeTexture(
         newHeight = (newWidth * src.orgHeight) / src.orgWidth;
     }
 
-    // Create a new texture with the same format and access as the source.
-    SDL_Texture* newTex = SDL_CreateTexture(
-        Sys::renderer,
+    // Create a new texture with the same format as the source, TARGET as it's rendered into
+    SDL_Texture* newTex = acquireTexture(
         src.getFormat(),
-        src.getAccess(),
+        SDL_TEXTUREACCESS_TARGET,
         newWidth,
         newHeight
     );
@@ -572,30 +1137,34 @@ int TM::resizeTexture(
     // Set Scale Mode for the Texture -------------------------------------------------------------
     bool err = SDL_SetTextureScaleMode(newTex, SDL_SCALEMODE_LINEAR);
     if(!err){
-        SDL_DestroyTexture(newTex);
+        TM::destroyTexture(newTex);
         return TM_STSM_FAILED;
     }
 
     // Make texture Updatable/Modifiable ----------------------------------------------------------
     err = SDL_SetTextureBlendMode(newTex, SDL_BLENDMODE_BLEND);
     if(!err){
-        SDL_DestroyTexture(newTex);
+        TM::destroyTexture(newTex);
         return TM_TEXTURE_SET_BLENDMODE_ERROR;
     }
 
+    // Draw pending GUI commands first, they might be drawing into src
+    DrawList::flush();
+
     // Capture the previous target
     auto old_renderTarget = SDL_GetRenderTarget(Sys::renderer);
 
     // Set the new texture as the render target.
-    err = SDL_SetRenderTarget(Sys::renderer, newTex);
+    err = TM::setRenderTarget(newTex);
     if (!err) {
-        SDL_DestroyTexture(newTex);
+        TM::destroyTexture(newTex);
         return TM_SRT_FAILED; // Set Render Target FAILED
     }
 
     // Clear the new texture (fill with blue).
     SDL_SetRenderDrawColor(Sys::renderer, 0, 0, 0, 0);
     SDL_RenderClear(Sys::renderer);
+    Sys::counters.clearCalls++;
 
     // Copy from the source texture to the new texture.
     // SDL_RenderCopy will scale the source to fit the destination rectangle.
@@ -611,16 +1180,18 @@ int TM::resizeTexture(
         nullptr, 
         &dstRect
     );
+    Sys::counters.textureCalls++;
     if (!err) {
-        SDL_SetRenderTarget(Sys::renderer, old_renderTarget);
-        SDL_DestroyTexture(newTex);
+        TM::setRenderTarget(old_renderTarget);
+        TM::destroyTexture(newTex);
         return TM_RCPY_FAILED; // Render Copy FAILED
     }
 
     // Reset the render target back to the default
-    SDL_SetRenderTarget(Sys::renderer, old_renderTarget);
+    TM::setRenderTarget(old_renderTarget);
 
     // Update the TextureData object with the new texture and dimensions.
+    ownTexture(newTex);
     dst.setTexture(newTex);
     dst.reloadInfo();
 
@@ -647,7 +1218,7 @@ int TM::rotateTexture(
     int                 angle
 ) {
     // 1) Validate inputs
-    SDL_Texture* srcTex = src.getTexture();
+    SDL_Texture* srcTex = useTexture(src);
     if (!srcTex || !Sys::renderer) {
         return INVALID_ARGUMENTS_PASSED;      // no source texture or renderer
     }
@@ -671,6 +1242,7 @@ int TM::rotateTexture(
     if(errorCode) return errorCode;
 
     // 5) Attach to dst TextureData and update metadata
+    ownTexture(newTex);
     dst.setTexture(newTex);
     dst.reloadInfo();
     dst.orgWidth  = dst.getWidth();
@@ -687,7 +1259,7 @@ int TM::cropTexture(
     SDL_Rect           rect
 ) {
     // 1) Validate inputs
-    SDL_Texture* srcTex = src.getTexture();
+    SDL_Texture* srcTex = useTexture(src);
     if (!srcTex || !Sys::renderer) {
         return INVALID_ARGUMENTS_PASSED;
     }
@@ -703,10 +1275,9 @@ int TM::cropTexture(
 
     // 2) Create a new render‐target texture of the crop size,
     //    matching the source’s pixel format
-    SDL_Texture* newTex = SDL_CreateTexture(
-        Sys::renderer,
+    SDL_Texture* newTex = acquireTexture(
         src.getFormat(),
-        TextureData::defaultAccess,
+        SDL_TEXTUREACCESS_TARGET,
         rect.w,
         rect.h
     );
@@ -716,24 +1287,26 @@ int TM::cropTexture(
     // Set Scale Mode for the Texture -------------------------------------------------------------
     bool err = SDL_SetTextureScaleMode(newTex, SDL_SCALEMODE_LINEAR);
     if(!err){
-        SDL_DestroyTexture(newTex);
+        TM::destroyTexture(newTex);
         return TM_STSM_FAILED;
     }
 
     // Make texture Updatable/Modifiable ----------------------------------------------------------
     err = SDL_SetTextureBlendMode(newTex, SDL_BLENDMODE_BLEND);
     if(!err){
-        SDL_DestroyTexture(newTex);
+        TM::destroyTexture(newTex);
         return TM_TEXTURE_SET_BLENDMODE_ERROR;
     }
 
 
 
     // 3) Render the specified region into the new texture
+    // Draw pending GUI commands first, they might be drawing into src
+    DrawList::flush();
     SDL_Texture* oldTarget = SDL_GetRenderTarget(Sys::renderer);
-    err = SDL_SetRenderTarget(Sys::renderer, newTex);
+    err = TM::setRenderTarget(newTex);
     if (!err) {
-        SDL_DestroyTexture(newTex);
+        TM::destroyTexture(newTex);
         return TM_SRT_FAILED;
     }
 
@@ -752,6 +1325,11 @@ int TM::cropTexture(
         float(rect.h)
     };
 
+    // Pooled textures still have the old pixels
+    SDL_SetRenderDrawColor(Sys::renderer, 0, 0, 0, 0);
+    SDL_RenderClear(Sys::renderer);
+    Sys::counters.clearCalls++;
+
     // Copy that region (no rotation, no flip)
     SDL_RenderTextureRotated(
         Sys::renderer,
@@ -762,11 +1340,13 @@ int TM::cropTexture(
         nullptr,       // center not used
         SDL_FLIP_NONE
     );
+    Sys::counters.textureCalls++;
 
     // Restore previous render‐target
-    SDL_SetRenderTarget(Sys::renderer, oldTarget);
+    TM::setRenderTarget(oldTarget);
 
     // 4) Attach the new texture to dst and update its metadata
+    ownTexture(newTex);
     dst.setTexture(newTex);
     dst.reloadInfo();
     dst.orgWidth  = dst.getWidth();
@@ -782,7 +1362,7 @@ int TM::transformTexture(
     PixelMapper           pixelFunc
 ) {
 
-    if (!Sys::renderer || !src.getTexture())
+    if (!Sys::renderer || !useTexture(src))
         return INVALID_ARGUMENTS_PASSED;
 
     SDL_Surface* surf;
@@ -815,8 +1395,12 @@ int TM::transformTexture(
     }
     SDL_UnlockSurface(surf);
 
-    SDL_Texture* newTex;
-    TM::convert_toTexture(surf, newTex);
+    SDL_Texture* newTex = nullptr;
+    int errorCode = TM::convert_toTexture(surf, newTex);
+    SDL_DestroySurface(surf);
+    if(errorCode) return errorCode;
+
+    ownTexture(newTex);
     dst.setTexture(newTex);
     dst.reloadInfo();
     dst.orgWidth  = dst.getWidth();
@@ -829,8 +1413,9 @@ int TM::exportTexture(
     const std::string&  path, 
     const TextureData&  td
 ) {
-    if (!td.getTexture() || !Sys::renderer) return INVALID_ARGUMENTS_PASSED;
-    return exportTexture(path, td.getTexture());
+    SDL_Texture* tex = useTexture(td);
+    if (!tex || !Sys::renderer) return INVALID_ARGUMENTS_PASSED;
+    return exportTexture(path, tex);
 }
 
 int TM::exportTexture(
@@ -884,8 +1469,7 @@ int TM::convert_toTexture(
     if (cvMat.type() != CV_8UC4) return TM_MAT_INVALID_FORMAT;
 
 
-    SDL_Texture* tex = SDL_CreateTexture(
-        Sys::renderer,
+    SDL_Texture* tex = createTexture(
         TextureData::defaultPixelFormat,    // RGBA order, 8 bits per channel
         TextureData::defaultAccess,         // one-time updates
         cvMat.cols,                         // width
@@ -898,7 +1482,7 @@ int TM::convert_toTexture(
 
     // 3) Upload the OpenCV buffer directly into the texture.
     //    cvMat.step is the number of bytes per row in memory.
-    bool err = SDL_UpdateTexture(
+    bool err = TM::updateTexture(
         tex,
         nullptr,                 // entire texture
         cvMat.data,
@@ -906,25 +1490,26 @@ int TM::convert_toTexture(
     );
 
     if (!err){
-        SDL_DestroyTexture(tex);
+        TM::destroyTexture(tex);
         return TM_TEXTURE_UPDATE_ERROR;
     }
 
     // Set Scale Mode for the Texture -------------------------------------------------------------
     err = SDL_SetTextureScaleMode(tex, SDL_SCALEMODE_LINEAR);
     if(!err){
-        SDL_DestroyTexture(tex);
+        TM::destroyTexture(tex);
         return TM_STSM_FAILED;
     }
 
     // Make texture Updatable/Modifiable ----------------------------------------------------------
     err = SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_BLEND);
     if(!err){
-        SDL_DestroyTexture(tex);
+        TM::destroyTexture(tex);
         return TM_TEXTURE_SET_BLENDMODE_ERROR;
     }
 
     // Store the texture
+    ownTexture(tex);
     td.setTexture(tex);
 
     // Retrieve texture dimensions.
@@ -942,7 +1527,7 @@ int TM::convert_textureTo(
     cv::Mat&            cvMat
 ){
     // 1) Validate inputs
-    if (!td.getTexture() || !Sys::renderer) {
+    if (!useTexture(td) || !Sys::renderer) {
         return INVALID_ARGUMENTS_PASSED;
     }
     
@@ -982,9 +1567,11 @@ int TM::convert_toTexture(
 ){
     td.setTexture(nullptr);
 
-    SDL_Texture* tex;
-    convert_toTexture(surface, tex);
+    SDL_Texture* tex = nullptr;
+    int errorCode = convert_toTexture(surface, tex);
+    if(errorCode) return errorCode;
 
+    ownTexture(tex);
     td.setTexture(tex);
     td.reloadInfo();
 
@@ -998,8 +1585,7 @@ int TM::convert_toTexture(
     SDL_Texture*&       tex
 ){
     // Create SDL_Texture* ------------------------------------------------------------------------
-    tex = SDL_CreateTexture(
-        Sys::renderer,
+    tex = createTexture(
         TextureData::defaultPixelFormat,
         TextureData::defaultAccess,
         surface->w,
@@ -1007,37 +1593,33 @@ int TM::convert_toTexture(
     );
     if(tex == nullptr) return TM_TEXTURE_CREATE_ERROR;
 
-
-    // Cleat the texture to be transparent --------------------------------------------------------
-    auto oldTarget = SDL_GetRenderTarget(Sys::renderer);
-    SDL_SetRenderTarget(Sys::renderer, tex);
-
-    SDL_SetRenderDrawColor(Sys::renderer, 0, 0, 0, 0);
-    SDL_RenderClear(Sys::renderer);
-
-    SDL_SetRenderTarget(Sys::renderer, oldTarget);
+    // No need to clear it first, the update below overwrites every pixel.
+    // On failure tex is destroyed and set to nullptr
 
 
     // Set Scale Mode for the Texture -------------------------------------------------------------
     bool err = SDL_SetTextureScaleMode(tex, SDL_SCALEMODE_LINEAR);
     if(!err){
-        SDL_DestroyTexture(tex);
+        TM::destroyTexture(tex);
+        tex = nullptr;
         cout << SDL_GetError() << endl;
         return TM_STSM_FAILED;
     }
     
 
     // Fill the texture with the image data -------------------------------------------------------
-    err = SDL_UpdateTexture(tex, NULL, surface->pixels, surface->pitch);
+    err = TM::updateTexture(tex, NULL, surface->pixels, surface->pitch);
     if(!err){
-        SDL_DestroyTexture(tex);
+        TM::destroyTexture(tex);
+        tex = nullptr;
         return TM_TEXTURE_UPDATE_ERROR;
     }
     
     // Make texture Updatable/Modifiable ----------------------------------------------------------
     err = SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_BLEND);
     if(!err){
-        SDL_DestroyTexture(tex);
+        TM::destroyTexture(tex);
+        tex = nullptr;
         return TM_TEXTURE_SET_BLENDMODE_ERROR;
     }
 
@@ -1051,50 +1633,64 @@ int TM::convert_textureTo(
     const TextureData&  td, 
     SDL_Surface*&       surface
 ){
-    // 1) Remember old render‐target, switch to the texture we want to read
-    SDL_Texture* oldTarget = SDL_GetRenderTarget(Sys::renderer);
-
-    bool err = SDL_SetRenderTarget(Sys::renderer, td.getTexture());
-    if (!err) {
-        return TM_SRT_FAILED;
-    }
-
-    // 2) Read *all* pixels from the current render‐target into a new SDL_Surface*
-    surface = SDL_RenderReadPixels(Sys::renderer, nullptr);
-    // Returns nullptr on failure; must free with SDL_DestroySurface()
-    if (!surface) {
-        SDL_SetRenderTarget(Sys::renderer, oldTarget);
-        return TM_RRP_FAILED;
-    }
-
-    // 3) Restore the previous target
-    SDL_SetRenderTarget(Sys::renderer, oldTarget);
-
-    return NO_ERROR;
+    return convert_textureTo(useTexture(td), surface);
 }
 
 int TM::convert_textureTo(
     SDL_Texture*  tex, 
     SDL_Surface*&       surface
 ){
+    if (!tex) return INVALID_ARGUMENTS_PASSED;
+
     // 1) Remember old render‐target, switch to the texture we want to read
+    // Draw pending GUI commands first, they might be drawing into it
+    DrawList::flush();
     SDL_Texture* oldTarget = SDL_GetRenderTarget(Sys::renderer);
 
-    bool err = SDL_SetRenderTarget(Sys::renderer, tex);
+    // Only TARGET textures can be read, STATIC and STREAMING ones
+    // are copied into a temporary TARGET texture first
+    SDL_PropertiesID prop = SDL_GetTextureProperties(tex);
+    auto access = (SDL_TextureAccess)SDL_GetNumberProperty(prop, SDL_PROP_TEXTURE_ACCESS_NUMBER, SDL_TEXTUREACCESS_TARGET);
+    auto format = (SDL_PixelFormat)SDL_GetNumberProperty(prop, SDL_PROP_TEXTURE_FORMAT_NUMBER, TextureData::defaultPixelFormat);
+
+    SDL_Texture* readable = tex;
+    if (access != SDL_TEXTUREACCESS_TARGET) {
+        float w = 0, h = 0;
+        SDL_GetTextureSize(tex, &w, &h);
+
+        readable = acquireTexture(format, SDL_TEXTUREACCESS_TARGET, int(w), int(h));
+        if (!readable) return TM_TEXTURE_CREATE_ERROR;
+
+        if (!TM::setRenderTarget(readable)) {
+            TM::destroyTexture(readable);
+            return TM_SRT_FAILED;
+        }
+
+        // Copied as it is, blending would darken the semi-transparent pixels
+        SDL_BlendMode blend = SDL_BLENDMODE_BLEND;
+        SDL_GetTextureBlendMode(tex, &blend);
+        SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_NONE);
+        SDL_RenderTexture(Sys::renderer, tex, nullptr, nullptr);
+        Sys::counters.textureCalls++;
+        SDL_SetTextureBlendMode(tex, blend);
+    }
+
+    bool err = TM::setRenderTarget(readable);
     if (!err) {
+        if (readable != tex) TM::destroyTexture(readable);
         return TM_SRT_FAILED;
     }
 
     // 2) Read *all* pixels from the current render‐target into a new SDL_Surface*
     surface = SDL_RenderReadPixels(Sys::renderer, nullptr);
-    // Returns nullptr on failure; must free with SDL_DestroySurface()
-    if (!surface) {
-        SDL_SetRenderTarget(Sys::renderer, oldTarget);
-        return TM_RRP_FAILED;
-    }
+    Sys::counters.readPixelsCalls++;
 
     // 3) Restore the previous target
-    SDL_SetRenderTarget(Sys::renderer, oldTarget);
+    TM::setRenderTarget(oldTarget);
+    if (readable != tex) TM::destroyTexture(readable);
+
+    // Returns nullptr on failure; must free with SDL_DestroySurface()
+    if (!surface) return TM_RRP_FAILED;
 
     return NO_ERROR;
 }
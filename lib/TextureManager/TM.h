@@ -22,6 +22,53 @@ extern "C" {
 using PixelMapper = std::function<SDL_Color(uint8_t, uint8_t, uint8_t, uint8_t)>;
 
 
+/**
+ * @brief What a texture is used for, the texture memory is reported
+ * per category (TM::getTextureMemory). Everything that TM::createTexture
+ * makes starts as SCRATCH and gets moved by whoever knows better.
+ */
+enum class TextureCategory {
+    IMAGES,     // Loaded from files, TM::loadTexture
+    TEXT,       // Text textures and the glyph atlas
+    ICONS,      // SVG icons
+    SCRATCH     // Copies, render targets, shapes and the rest
+};
+
+/** @brief Texture memory, in bytes, see TM::getTextureMemory. */
+struct TextureMemory {
+    size_t total;
+    size_t images;
+    size_t text;
+    size_t icons;
+    size_t scratch;
+
+    size_t evictable;   // Images that can be evicted and loaded again
+    size_t budget;      // 0 means no budget
+
+    int textures;       // Live textures
+    Uint64 evictions;
+    Uint64 reloads;
+};
+
+/** @brief Counters of the texture pool, see TM::acquireTexture. */
+struct TexturePoolStats {
+    Uint64 hits;
+    Uint64 misses;
+    int pooled;             // Textures waiting in the pool
+    size_t pooledBytes;
+    int inUse;              // Pool textures handed out
+    size_t inUseBytes;
+};
+
+/** @brief Counters of the load cache of TM::loadTexture. */
+struct LoadCacheStats {
+    Uint64 hits;
+    Uint64 misses;
+    int entries;
+};
+
+
+
 /** GENERAL STRUCT FOR IMAGES -----------------------------------------------------------------------
  * This is a TextureData object which allows easy managment of Textures
  * 
@@ -46,7 +93,11 @@ using PixelMapper = std::function<SDL_Color(uint8_t, uint8_t, uint8_t, uint8_t)>
  *    means that if no other objects are pointing to the old SDL_Texture* it will
  *    be deleted, if the AUTO_DELETE_TEXTURES is set to false, or any other TextureData
  *    object is pointing to the old SDL_Texture* that it will be just replaced and
- *    not freeed
+ *    not freeed. Textures made by TM itself (loadTexture, copyTexture...) belong
+ *    to no one else, so they are always freed once nothing points to them
+ * 
+ * How many TextureData objects point to every SDL_Texture* is counted in
+ * TM::textureRefs, so that check is a single hash map lookup.
  * 
  * Also it is important to note that creating a TextureData object directly is 
  * illegal, in order to create a TextureData object you need to you TextureDataPtr
@@ -95,7 +146,9 @@ public:
     //–––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––––
 
     // Replace the SDL_Texture*.  If no other TextureData still points at
-    // the old texture, it will be destroyed (or stashed in outOfScopeTextures).
+    // the old texture, it will be destroyed (or left alone if AUTO_DELETE_TEXTURES
+    // is false and TM didn't make it). Only on the main thread, dropping a
+    // TextureData works on any thread.
     void setTexture(SDL_Texture* newTex);
 
     // Manually re‑query width/height/format/access
@@ -104,7 +157,14 @@ public:
     void printf(bool full = false) const;
 
     static inline SDL_PixelFormat defaultPixelFormat = SDL_PIXELFORMAT_RGBA32;
-    static inline SDL_TextureAccess defaultAccess = SDL_TEXTUREACCESS_TARGET;
+
+    // ACCESS POLICY
+    // Textures made from pixels (images, SVGs, text, surfaces, cv::Mat) are
+    // uploaded once and never rendered into, so they are STATIC. Only the
+    // outputs of copyTexture, resizeTexture and cropTexture are TARGET, as
+    // they are rendered into. Set it to TARGET if you render into loaded
+    // images yourself. Reading pixels back works with both.
+    static inline SDL_TextureAccess defaultAccess = SDL_TEXTUREACCESS_STATIC;
     
         
 private:
@@ -117,6 +177,21 @@ private:
         SDL_TextureAccess   access  = defaultAccess;
         int                 width   = 0;
         int                 height  = 0;
+
+        // EVICTION, only for textures loaded from a file by TM::loadTexture.
+        // Evicted textures keep their size, they are loaded again with the next use
+        string              source;
+        bool                evicted = false;
+        int                 lastUsedFrame = -1;
+        bool                inLru = false;
+        Impl*               lruPrev = nullptr;
+        Impl*               lruNext = nullptr;
+
+        // Next in TM::pendingImpls, when the last copy was dropped on another thread
+        Impl*               pendingNext = nullptr;
+
+        // The last handle is gone, the texture is released
+        ~Impl();
     };
 
     std::shared_ptr<Impl> dptr_;
@@ -148,22 +223,45 @@ private:
     // NSVG RASTERIZER
     static inline NSVGrasterizer *rast;
 
-    // A vector that holds all of the TextureData objects that have been
-    // created, as a weak pointer. Used to keep track of loaded Textures
-    static inline std::vector<std::weak_ptr<TextureData::Impl>> loadedTextures;
+    // How many TextureData objects (their Impl, copies share one) point to
+    // every SDL_Texture*. Textures that aren't in it have no TextureData
+    static inline unordered_map<SDL_Texture*, int> textureRefs;
+
+    // DEFERRED DESTRUCTION
+    // SDL and the maps of TM are only touched on the main thread. An Impl
+    // whose last copy is dropped on another thread is pushed on this lock-free
+    // list (linked trough Impl::pendingNext) and deleted by Sys::presentFrame
+    static inline std::atomic<TextureData::Impl*> pendingImpls{nullptr};
+
+    // TM::destroyTexture doesn't destroy right away, draws that are queued or
+    // still in flight might use the texture. They are destroyed together by
+    // Sys::presentFrame, DESTROY_DELAY_FRAMES frames later
+    struct DestroyedTexture {
+        SDL_Texture* texture;
+        int frame;
+    };
+    static inline vector<DestroyedTexture> destroyQueue;
+    static inline const int DESTROY_DELAY_FRAMES = 2;
+
+    // Deleter of the Impl shared_ptr
+    static void deleteImpl(TextureData::Impl* impl);
 
-    // If SDL_Texture* went out of scope but AUTO_DELETE_TEXTURES is
-    // set to false, the textures are stored here
-    static inline std::vector<SDL_Texture*> outOfScopeTextures;
+    // Deletes the pending Impls and destroys the textures that waited long
+    // enough, all of them if all is true (Sys::cleanup)
+    static void processDestroyQueue(bool all = false);
 
 
-    // Private function called by TextureData::create()
-    // It adds the newly created TextureDataPtr to the loadedTextures vector
-    static void registerTexture(shared_ptr<TextureData::Impl> const& ptr);
+    // Private function called when a TextureData gets a texture
+    static void retainTexture(SDL_Texture* tex);
 
-    // Private function called by TextureData destructor
-    // It removes the TextureData obj from loadedTextures vector
-    static void removeTexture(shared_ptr<TextureData::Impl> dead);
+    // Private function called when a TextureData lets go of a texture.
+    // When nothing points to it anymore it gets destroyed, unless it was
+    // replaced (setTexture), AUTO_DELETE_TEXTURES is false and it's not owned
+    static void releaseTexture(SDL_Texture* tex, bool replaced);
+
+    // Marks a texture TM made for a TextureData, nobody else has it so TM
+    // always destroys it, whatever AUTO_DELETE_TEXTURES says
+    static void ownTexture(SDL_Texture* tex);
 
 
     // A global variable that is used when deciding what do the with the textures
@@ -177,15 +275,247 @@ private:
     // If you wish to change the value of this use TM::setAutoDeleteTextures(bool);
     static inline bool AUTO_DELETE_TEXTURES = true;
 
+    // Counts every SDL_Texture* created trough TM::createTexture
+    static inline Uint64 createdTexturesCount = 0;
+
+    // TEXTURE MEMORY
+    // Every texture made by TM::createTexture, until TM::destroyTexture
+    struct TextureInfo {
+        size_t bytes;
+        TextureCategory category;
+        SDL_PixelFormat format;
+        SDL_TextureAccess access;
+        int width, height;
+        bool pooled = false;    // Made by TM::acquireTexture
+        bool owned = false;     // Made by TM for a TextureData (loadTexture, copyTexture...)
+    };
+    static inline unordered_map<SDL_Texture*, TextureInfo> textureInfo;
+    static inline size_t categoryBytes[4] = {};
+    static inline size_t totalTextureBytes = 0;
+
+    // Textures loaded from files, front is the most recently used.
+    // Over the budget the least recently used get evicted. Loads of the
+    // same file share the texture, lruTextures has every Impl of the list
+    // by texture so they are evicted (and marked evicted) together
+    static inline TextureData::Impl* lruFront = nullptr;
+    static inline TextureData::Impl* lruBack = nullptr;
+    static inline unordered_multimap<SDL_Texture*, TextureData::Impl*> lruTextures;
+    static inline size_t textureBudget = 0;
+    static inline Uint64 evictionCount = 0;
+    static inline Uint64 reloadCount = 0;
+
+    // LOAD CACHE
+    // Files loaded by TM::loadTexture, key is the canonical path. An entry
+    // only counts while the file has the same size and mtime and the Impl
+    // of the first load still holds that file, loaded
+    struct LoadCacheEntry {
+        std::weak_ptr<TextureData::Impl> impl;
+        string source;
+        uintmax_t size;
+        fs::file_time_type mtime;
+    };
+    static inline unordered_map<string, LoadCacheEntry> loadCache;
+    static inline size_t loadCacheSweepAt = 64;
+    static inline Uint64 loadCacheHits = 0;
+    static inline Uint64 loadCacheMisses = 0;
+
+    // TEXTURE POOL
+    // Textures made by TM::acquireTexture, TM::destroyTexture puts them here
+    // insted of destroying them. They are handed out again only after
+    // POOL_DELAY_FRAMES, so draws that were still using them are done by then.
+    // One FIFO per format, access and size, the size is exact as TextureData
+    // takes its size from the texture. Empty FIFOs are removed
+    struct PoolKey {
+        SDL_PixelFormat format;
+        SDL_TextureAccess access;
+        int width, height;
+
+        bool operator==(const PoolKey& o) const {
+            return format == o.format && access == o.access && width == o.width && height == o.height;
+        }
+    };
+
+    struct PoolKeyHash {
+        size_t operator()(const PoolKey& k) const {
+            uint64_t h = hashMix(hashMix(k.format, k.access), k.width);
+            return static_cast<size_t>(hashMix(h, k.height));
+        }
+    };
+
+    struct PooledTexture {
+        SDL_Texture* texture;
+        int releasedFrame;
+    };
+    static inline unordered_map<PoolKey, std::deque<PooledTexture>, PoolKeyHash> texturePool;
+    static inline int pooledCount = 0;
+    static inline size_t pooledBytes = 0;
+    static inline int poolTextures = 0;         // Pooled or handed out
+    static inline size_t poolTextureBytes = 0;
+    static inline Uint64 poolHits = 0;
+    static inline Uint64 poolMisses = 0;
+
+    static inline const int POOL_DELAY_FRAMES = 2;
+    static inline const int POOL_MAX_AGE = 300;                     // In frames
+    static inline const size_t POOL_MAX_BYTES = 64 * 1024 * 1024;
+
+    // Destroys the pooled textures that waited for too long or don't fit
+    // in POOL_MAX_BYTES, called by Sys::presentFrame
+    static void trimTexturePool();
+    // Destroys all of them, called by Sys::cleanup
+    static void clearTexturePool();
+    // Destroys the oldest pooled textures until at most maxBytes are pooled
+    static void shrinkTexturePool(size_t maxBytes);
+    // The texture really gets destroyed by TM::destroyTexture, not pooled
+    static void unpoolTexture(SDL_Texture* tex);
+    // Takes the first texture of the FIFO out of the pool and destroys it
+    static void dropPooledTexture(std::deque<PooledTexture>& fifo);
+
+    static size_t textureBytes(SDL_Texture* tex);
+    static void linkTexture(TextureData::Impl* impl);
+    static void unlinkTexture(TextureData::Impl* impl);
+    // True if every TextureData pointing to tex can load it again, and
+    // none of them used it in this frame
+    static bool canEvict(SDL_Texture* tex, int frame);
+    static void evictTexture(SDL_Texture* tex);
+    static void enforceTextureBudget();
+
+    // Canonical path of the file, "" (no caching) if it can't be stat-ed
+    static string loadCacheKey(const string& path, uintmax_t& size, fs::file_time_type& mtime);
+    // The texture of a loaded file, nullptr if it isn't loaded or it changed
+    static SDL_Texture* findLoadCache(const string& key, uintmax_t size, fs::file_time_type mtime);
+    static void storeLoadCache(
+        const string& key,
+        const std::shared_ptr<TextureData::Impl>& impl,
+        uintmax_t size,
+        fs::file_time_type mtime
+    );
+
 
 
 public:
 
 // TextureData Managment ------------------------------------------------------------
 
+    /**
+     * Creates a new SDL_Texture* on the Sys::renderer.
+     * Every texture that Lumos creates goes trough this function,
+     * so the number of created textures can be tracked.
+     *
+     * @param format Pixel format of the texture
+     * @param access Access mode of the texture
+     * @param width Width of the texture
+     * @param height Height of the texture
+     *
+     * @return SDL_Texture* or nullptr on failure (check SDL_GetError())
+     */
+    static SDL_Texture* createTexture(
+        SDL_PixelFormat format,
+        SDL_TextureAccess access,
+        int width,
+        int height
+    );
+
+    /**
+     * Destroys a SDL_Texture*. GUI draw commands might still be using
+     * it, so it's really destroyed by Sys::presentFrame a couple of
+     * frames later, together with the rest.
+     *
+     * @param tex Texture to be destroyed, nullptr is ignored
+     */
+    static void destroyTexture(SDL_Texture* tex);
+
+    /**
+     * Destroys the textures waiting for Sys::presentFrame right away.
+     * Does nothing while there are GUI draw commands waiting, they might
+     * use them. For loading screens and benchmarks, where no frame is
+     * being drawn.
+     */
+    static void flushDestroyedTextures();
+
+    /**
+     * Same as TM::createTexture, but the texture comes from a pool of
+     * textures that were destroyed at least a couple of frames ago, when
+     * there is one with the same format, access and size. TM::destroyTexture
+     * gives it back to the pool.
+     *
+     * The old pixels are still in it, clear or overwrite all of it.
+     *
+     * @return SDL_Texture* or nullptr on failure (check SDL_GetError())
+     */
+    static SDL_Texture* acquireTexture(
+        SDL_PixelFormat format,
+        SDL_TextureAccess access,
+        int width,
+        int height
+    );
+
+    /** @brief Hit rate and memory of the pool of TM::acquireTexture. */
+    static TexturePoolStats getTexturePoolStats();
+
+    /**
+     * Same as SDL_UpdateTexture, but the uploaded bytes are counted
+     * (Sys::getFrameStats) and the damage tracking is told that the
+     * contents changed.
+     *
+     * @param rect Part of the texture to update, nullptr for all of it
+     * @return true on success (check SDL_GetError())
+     */
+    static bool updateTexture(SDL_Texture* tex, const SDL_Rect* rect, const void* pixels, int pitch);
+
+    /**
+     * Same as SDL_SetRenderTarget on the Sys::renderer, but the
+     * target switches are counted (Sys::getFrameStats).
+     *
+     * @return true on success (check SDL_GetError())
+     */
+    static bool setRenderTarget(SDL_Texture* target);
+
+    /**
+     * @brief Returns how many textures have been created trough
+     * TM::createTexture since the start of the program.
+     */
+    static Uint64 getCreatedTexturesCount();
+
+    /**
+     * @brief Moves the texture into a category of TM::getTextureMemory,
+     * textures made by TM::createTexture start as SCRATCH.
+     */
+    static void setTextureCategory(SDL_Texture* tex, TextureCategory category);
+
+    /**
+     * @brief Sets the texture memory budget in bytes, 0 means no budget.
+     *
+     * Over the budget the least recently used textures loaded trough
+     * TM::loadTexture are evicted (destroyed, the TextureData keeps the
+     * path and the size) and loaded again when they are used, see
+     * TM::useTexture. Textures used in the current frame are never
+     * evicted, and other textures can't be, so the budget is soft.
+     */
+    static void setTextureBudget(size_t bytes);
+
+    /** @brief How much texture memory is used, in total and per category. */
+    static TextureMemory getTextureMemory();
+
+    /**
+     * @brief Marks the texture as used and, if it was evicted, loads
+     * it again from its file. GUI::Image and the TM functions that take
+     * a TextureData do it, call it before using td.getTexture() yourself.
+     *
+     * @return The texture, nullptr if it can't be loaded
+     */
+    static SDL_Texture* useTexture(const TextureData& td);
+
     /**
      * Loading Textures from a Path.
      * 
+     * The same file is decoded only once: loading a path that is already
+     * loaded (same canonical path, size and modification time) makes td
+     * point to the same SDL_Texture* as the first TextureData. The texture
+     * is shared: color and alpha mod, blend and scale mode or updating the
+     * pixels of td.getTexture() change it for every TextureData of that
+     * file. setTexture, and loading something else, only change td.
+     * Use TM::invalidateLoadCache to force a new decode.
+     * 
      * @param td TextureData variable in which texture will be stored
      * @param path Path to the image
      * @param id Optional, if not set it will be equal to the file path
@@ -198,6 +528,17 @@ public:
         const string& id = ""
     );
 
+    /**
+     * @brief Makes the next TM::loadTexture of the path decode the file
+     * again. TextureData objects already loaded keep their texture.
+     *
+     * @param path The file, empty for every file
+     */
+    static void invalidateLoadCache(const string& path = "");
+
+    /** @brief Hits and misses of the load cache of TM::loadTexture. */
+    static LoadCacheStats getLoadCacheStats();
+
     /**
      * @brief Load *.svg file into a specific dimension Texture.
      * Convinient for loading and rendering icons.
@@ -15,6 +15,11 @@
 #include <set>                  // For sets (gui.h)
 #include <any>                  // std::any
 #include <thread>               // threads
+#include <atomic>               // std::atomic
+#include <mutex>                // std::mutex, std::lock_guard
+#include <condition_variable>   // std::condition_variable
+#include <deque>                // std::deque
+#include <memory>               // std::unique_ptr
 #include <type_traits>          // for std::decay_t
 
 using namespace std;
@@ -75,6 +80,10 @@ inline Uint32 toUint32(const SDL_Color& color) {
 #define SYS_FPS_TOO_LOW                 0x06
 #define SYS_FPS_TOO_HIGH                0x07
 #define SYS_FONT_NOT_INITED             0x08
+#define SYS_VSYNC_ERROR                 0x09
+#define SYS_TRACE_WRITE_ERROR           0x0a
+#define SYS_GLYPH_ATLAS_IO_ERROR        0x0b        // Glyph atlas file can't be read or written
+#define SYS_GLYPH_ATLAS_INVALID         0x0c        // Not a glyph atlas, or baked for a different font
 //  SYS RESERVED                        0x1f
 
 #define TM_SURFACE_CREATE_ERROR         0x20
@@ -364,6 +373,27 @@ inline SDL_Color hex2sdlColor(string hex){
 
 
 
+// HASHING ---------------------------------------------------------------------
+// FNV-1a, 64 bit. Fast enough for short keys, not meant for anything secure
+const uint64_t FNV_OFFSET = 1469598103934665603ull;
+
+inline uint64_t hashBytes(const void* data, size_t size, uint64_t h = FNV_OFFSET){
+    const Uint8* bytes = static_cast<const Uint8*>(data);
+    for(size_t i = 0; i < size; i++){
+        h ^= bytes[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+inline uint64_t hashMix(uint64_t h, uint64_t v){
+    return hashBytes(&v, sizeof(v), h);
+}
+
+
+
+
+
 // SDL_Point and SDL_Rect OPERATIONS OVERLOAD ----------------------------------------------
 // SDL_Point + SDL_Point
 inline SDL_Point operator+(const SDL_Point& p1, const SDL_Point& p2) {